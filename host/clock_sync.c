@@ -0,0 +1,173 @@
+/*
+ * SPI clock synchronisation estimator
+ *
+ * Maps the board's Timer1 timestamps onto the Pi's CLOCK_MONOTONIC_RAW.
+ * Each sample sends the 0x86 sync command and brackets the transfer of that
+ * byte with two host clock reads. The board latches Timer1 as the byte
+ * completes, so the latched value belongs somewhere inside that window.
+ * A least-squares fit over the samples gives the offset and drift. Samples
+ * whose window is much wider than the best one were disturbed by the
+ * scheduler and are left out of the fit.
+ *
+ * Build on the Pi:
+ *   gcc -O2 -o clock_sync clock_sync.c -lm
+ *
+ * Usage:
+ *   clock_sync [device] [samples] [interval ms]
+ * Defaults are /dev/spidev0.0, 200 samples and 20 ms apart.
+ */
+
+#include <fcntl.h>
+#include <linux/spi/spidev.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CMD_SYNC 0x86
+
+#define SPI_SPEED_HZ 1000000
+/* Gap the ISR needs to load the next response byte */
+#define SPI_BYTE_GAP_US 20
+
+/* Timer1 runs at 2 MHz on the 16 MHz board */
+#define TICKS_PER_US 2
+
+/* Samples with a window over this multiple of the narrowest are dropped */
+#define WINDOW_LIMIT 2.0
+
+typedef struct {
+	double ticks;   /* unwrapped Timer1 value */
+	double host;    /* window midpoint, ns */
+	double window;  /* window width, ns */
+} sample_t;
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int transfer(int fd, uint8_t* byte) {
+	struct spi_ioc_transfer t;
+	memset(&t, 0, sizeof(t));
+	t.tx_buf = (unsigned long)byte;
+	t.rx_buf = (unsigned long)byte;
+	t.len = 1;
+	t.speed_hz = SPI_SPEED_HZ;
+	t.bits_per_word = 8;
+	t.delay_usecs = SPI_BYTE_GAP_US;
+	return ioctl(fd, SPI_IOC_MESSAGE(1), &t);
+}
+
+static int sample(int fd, uint32_t* ticks, double* host, double* window) {
+	uint8_t byte = CMD_SYNC;
+	double before = now_ns();
+	if (transfer(fd, &byte) < 0) {
+		return -1;
+	}
+	double after = now_ns();
+
+	uint32_t value = 0;
+	for (int i = 0; i < 4; i++) {
+		byte = 0;
+		if (transfer(fd, &byte) < 0) {
+			return -1;
+		}
+		value |= (uint32_t)byte << (8 * i);
+	}
+	*ticks = value;
+	*host = (before + after) / 2;
+	*window = after - before;
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	const char* device = argc > 1 ? argv[1] : "/dev/spidev0.0";
+	int count = argc > 2 ? atoi(argv[2]) : 200;
+	int interval = argc > 3 ? atoi(argv[3]) : 20;
+
+	int fd = open(device, O_RDWR);
+	if (fd < 0) {
+		perror(device);
+		return 1;
+	}
+	uint8_t mode = SPI_MODE_0;
+	ioctl(fd, SPI_IOC_WR_MODE, &mode);
+
+	sample_t* samples = calloc(count, sizeof(sample_t));
+	double narrowest = INFINITY;
+	uint32_t last = 0;
+	double wraps = 0;
+	for (int i = 0; i < count; i++) {
+		uint32_t ticks;
+		if (sample(fd, &ticks, &samples[i].host, &samples[i].window) < 0) {
+			perror("SPI transfer");
+			return 1;
+		}
+		/* Timer1 wraps every 35 minutes at 2 MHz */
+		if (i > 0 && ticks < last) {
+			wraps += 4294967296.0;
+		}
+		last = ticks;
+		samples[i].ticks = ticks + wraps;
+		if (samples[i].window < narrowest) {
+			narrowest = samples[i].window;
+		}
+		usleep(interval * 1000);
+	}
+	close(fd);
+
+	/* Least squares fit of host time against ticks, centred for precision */
+	double mx = 0, my = 0;
+	int used = 0;
+	for (int i = 0; i < count; i++) {
+		if (samples[i].window <= narrowest * WINDOW_LIMIT) {
+			mx += samples[i].ticks;
+			my += samples[i].host;
+			used++;
+		}
+	}
+	if (used < 2) {
+		fprintf(stderr, "not enough samples\n");
+		return 1;
+	}
+	mx /= used;
+	my /= used;
+	double sxx = 0, sxy = 0;
+	for (int i = 0; i < count; i++) {
+		if (samples[i].window <= narrowest * WINDOW_LIMIT) {
+			double dx = samples[i].ticks - mx;
+			sxx += dx * dx;
+			sxy += dx * (samples[i].host - my);
+		}
+	}
+	double slope = sxy / sxx;
+	double offset = my - slope * mx;
+
+	/* Error bound: worst residual plus the half window it was taken in */
+	double rms = 0, bound = 0;
+	for (int i = 0; i < count; i++) {
+		if (samples[i].window <= narrowest * WINDOW_LIMIT) {
+			double r = samples[i].host - (offset + slope * samples[i].ticks);
+			rms += r * r;
+			if (fabs(r) + samples[i].window / 2 > bound) {
+				bound = fabs(r) + samples[i].window / 2;
+			}
+		}
+	}
+	rms = sqrt(rms / used);
+
+	double nominal = 1000.0 / TICKS_PER_US;
+	printf("samples used  %d of %d\n", used, count);
+	printf("host_ns       %.3f + %.9f * ticks\n", offset, slope);
+	printf("drift         %+.1f ppm (board fast if positive)\n", (nominal / slope - 1) * 1e6);
+	printf("residual rms  %.1f us\n", rms / 1000);
+	printf("error bound   %.1f us\n", bound / 1000);
+	free(samples);
+	return 0;
+}
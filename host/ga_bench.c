@@ -0,0 +1,71 @@
+/*
+ * Generations-per-second benchmark for the on-device GA
+ *
+ * Builds the firmware's GA engine for the host and evolves against a
+ * synthetic fitness, the number of bits matching a fixed target genome,
+ * timing the selection, crossover and mutation work per generation.
+ * Fitness evaluation is left out of the timing, as on the device it is
+ * the player's response.
+ *
+ * Build:
+ *   gcc -O2 -I../inc -o ga_bench ga_bench.c ../src/ga.c ../src/prng.c
+ *
+ * Usage:
+ *   ga_bench [generations]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ga.h"
+#include "prng.h"
+
+#define TARGET 0x5A3CC3A5UL
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint16_t fitness(genome_t g) {
+	return 32 - __builtin_popcount(g ^ TARGET);
+}
+
+int main(int argc, char** argv) {
+	long generations = argc > 1 ? atol(argv[1]) : 100000;
+	prng_seed(12345);
+	ga_reset();
+
+	double breedNs = 0;
+	long solvedAt = -1;
+	uint16_t best = 0;
+	for (long gen = 0; gen < generations; gen++) {
+		best = 0;
+		for (uint8_t i = 0; i < GA_POPULATION; i++) {
+			uint16_t f = fitness(ga_individual(i));
+			ga_set_fitness(i, f);
+			if (f > best) {
+				best = f;
+			}
+		}
+		if (best == 32 && solvedAt < 0) {
+			solvedAt = gen;
+		}
+		double start = now_ns();
+		while (!ga_breed());
+		breedNs += now_ns() - start;
+	}
+
+	printf("population %d, %ld generations\n", GA_POPULATION, generations);
+	printf("%.0f generations/s, %.1f ns per child\n",
+		generations / (breedNs / 1e9), breedNs / generations / GA_POPULATION);
+	if (solvedAt >= 0) {
+		printf("target genome first reached in generation %ld\n", solvedAt);
+	} else {
+		printf("target genome not reached, best %u of 32 bits\n", best);
+	}
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Throughput and quality check for the firmware's PRNG
+ *
+ * Builds prng.c for the host, times prng_fill() and runs a few quick
+ * statistical checks on its output: monobit, chi-square over byte values
+ * and the runs test. A pass here only rules out gross mistakes; it says
+ * nothing about unpredictability.
+ *
+ * The generator is seeded as on the device after boot, with a stream of
+ * stirred-in samples, here taken from the host clock's low bits.
+ *
+ * Build:
+ *   gcc -O2 -I../inc -o prng_bench prng_bench.c ../src/prng.c -lm
+ *
+ * Usage:
+ *   prng_bench [megabytes]
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "prng.h"
+
+#define BLOCK 32  // bytes per fill, as for the SPI random command
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static const char* verdict(double z) {
+	return fabs(z) < 3.0 ? "ok" : "FAIL";
+}
+
+int main(int argc, char** argv) {
+	long megabytes = argc > 1 ? atol(argv[1]) : 16;
+	long blocks = megabytes * 1024 * 1024 / BLOCK;
+
+	for (int i = 0; i < PRNG_BOOT_SAMPLES; i++) {
+		prng_stir((uint8_t)now_ns());
+	}
+
+	static uint8_t buf[BLOCK];
+	uint64_t counts[256] = { 0 };
+	uint64_t ones = 0;
+	uint64_t runs = 0;
+	int lastBit = -1;
+	double fillNs = 0;
+
+	for (long b = 0; b < blocks; b++) {
+		double start = now_ns();
+		prng_fill(buf, BLOCK);
+		fillNs += now_ns() - start;
+
+		for (int i = 0; i < BLOCK; i++) {
+			uint8_t x = buf[i];
+			counts[x]++;
+			ones += __builtin_popcount(x);
+			for (int bit = 0; bit < 8; bit++) {
+				int v = (x >> bit) & 1;
+				if (v != lastBit) {
+					runs++;
+					lastBit = v;
+				}
+			}
+		}
+	}
+
+	double bytes = (double)blocks * BLOCK;
+	double bits = bytes * 8;
+	printf("%.0f bytes in %d byte fills, %.2f ns/byte, %.0f MB/s\n",
+		bytes, BLOCK, fillNs / bytes, bytes / fillNs * 1e3);
+
+	// Monobit: ones ~ N(n/2, n/4)
+	double zMono = (ones - bits / 2) / sqrt(bits / 4);
+	printf("monobit:    %.4f ones, z = %+.2f  %s\n", ones / bits, zMono, verdict(zMono));
+
+	// Chi-square with 255 degrees of freedom, normalised to a z score
+	double expected = bytes / 256;
+	double chi = 0;
+	for (int i = 0; i < 256; i++) {
+		double d = counts[i] - expected;
+		chi += d * d / expected;
+	}
+	double zChi = (chi - 255) / sqrt(2 * 255);
+	printf("chi-square: %.1f (255 df), z = %+.2f  %s\n", chi, zChi, verdict(zChi));
+
+	// Runs: for a fair bit stream, runs ~ N(1 + (n-1)/2, (n-1)/4)
+	double zRuns = (runs - (1 + (bits - 1) / 2)) / sqrt((bits - 1) / 4);
+	printf("runs:       %.0f, z = %+.2f  %s\n", (double)runs, zRuns, verdict(zRuns));
+
+	prng_stats_t st;
+	prng_stats(&st);
+	printf("%u samples stirred, %u reseeds\n", (unsigned)st.samples, st.reseeds);
+	return fabs(zMono) < 3 && fabs(zChi) < 3 && fabs(zRuns) < 3 ? 0 : 1;
+}
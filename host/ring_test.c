@@ -0,0 +1,336 @@
+/*
+ * Unit and stress tests for ring.h
+ *
+ * Builds the firmware's ring buffers for the host and checks push and pop,
+ * full and empty, the free-running indices wrapping past 255, span, commit
+ * and the bulk calls across the end of the buffer, and push_overwrite,
+ * including a consumer that runs in the middle of an overwrite as the SPI
+ * ISR can. A two-thread producer and consumer then move a numbered stream
+ * through a ring with every mix of calls, checking it arrives in order.
+ *
+ * RING_BARRIER is a full fence here, since the threads may run on
+ * different cores, and doubles as the hook that interleaves the consumer.
+ * The firmware's sched.h would hide the system one, hence -iquote.
+ *
+ * Build:
+ *   gcc -O2 -iquote ../inc -o ring_test ring_test.c -lpthread
+ *
+ * Usage:
+ *   ring_test [million elements to stress with]
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Run once from the next barrier, to stand in for an interrupt
+static void (*interrupt)(void);
+static int interruptAfter;
+
+static void barrier(void) {
+	__sync_synchronize();
+	if (interrupt && --interruptAfter < 0) {
+		void (*isr)(void) = interrupt;
+		interrupt = NULL;
+		isr();
+	}
+}
+
+#define RING_BARRIER() barrier()
+#include "ring.h"
+
+typedef struct {
+	uint32_t seq;
+	uint32_t check;  // ~seq, so a torn element shows
+} element_t;
+
+RING_DEFINE(byte_ring, uint8_t, 16);
+RING_DEFINE(element_ring, element_t, 8);
+RING_DEFINE(stress_ring, uint8_t, 64);
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+static element_t element(uint32_t seq) {
+	element_t e = { seq, ~seq };
+	return e;
+}
+
+static void test_push_pop(void) {
+	byte_ring_t r = { 0 };
+	uint8_t b;
+	CHECK(byte_ring_count(&r) == 0);
+	CHECK(byte_ring_space(&r) == 16);
+	CHECK(!byte_ring_pop(&r, &b));
+
+	for (uint8_t i = 0; i < 16; i++) {
+		CHECK(byte_ring_push(&r, &i));
+	}
+	CHECK(byte_ring_count(&r) == 16);
+	CHECK(byte_ring_space(&r) == 0);
+	uint8_t extra = 99;
+	CHECK(!byte_ring_push(&r, &extra));
+	CHECK(byte_ring_count(&r) == 16);
+
+	for (uint8_t i = 0; i < 16; i++) {
+		CHECK(byte_ring_pop(&r, &b) && b == i);
+	}
+	CHECK(!byte_ring_pop(&r, &b));
+	CHECK(byte_ring_count(&r) == 0);
+}
+
+/*
+ * Walk the indices round several times with uneven batches, so head and
+ * tail wrap past 255 at every offset in the buffer
+ */
+static void test_wrap(void) {
+	byte_ring_t r = { 0 };
+	uint8_t in = 0;
+	uint8_t out = 0;
+	for (int round = 0; round < 1000; round++) {
+		int pushes = 1 + round % 13;
+		for (int i = 0; i < pushes && byte_ring_space(&r); i++, in++) {
+			CHECK(byte_ring_push(&r, &in));
+		}
+		CHECK(byte_ring_count(&r) == (uint8_t)(in - out));
+		int pops = 1 + round % 11;
+		uint8_t b;
+		for (int i = 0; i < pops && byte_ring_pop(&r, &b); i++, out++) {
+			CHECK(b == out);
+		}
+	}
+	CHECK(r.head == in && r.tail == out);
+}
+
+static void test_spans(void) {
+	byte_ring_t r = { 0 };
+	// Leave head and tail three short of the end of the buffer
+	r.head = r.tail = 256 - 3;
+
+	uint8_t* at;
+	CHECK(byte_ring_write_span(&r, &at) == 3);
+	CHECK(at == &r.buf[13]);
+	at[0] = 1;
+	at[1] = 2;
+	byte_ring_commit(&r, 2);
+	CHECK(byte_ring_count(&r) == 2);
+	CHECK(byte_ring_write_span(&r, &at) == 1);
+
+	const uint8_t* from;
+	CHECK(byte_ring_read_span(&r, &from) == 2);
+	CHECK(from[0] == 1 && from[1] == 2);
+	byte_ring_release(&r, 2);
+	CHECK(byte_ring_count(&r) == 0);
+
+	// Bulk calls straddling the end of the buffer and the index wrap
+	uint8_t src[20];
+	uint8_t dst[20];
+	for (uint8_t i = 0; i < sizeof(src); i++) {
+		src[i] = 100 + i;
+	}
+	CHECK(byte_ring_push_bulk(&r, src, 10) == 10);
+	CHECK(byte_ring_count(&r) == 10);
+	CHECK(byte_ring_push_bulk(&r, src + 10, 10) == 6);
+	CHECK(byte_ring_space(&r) == 0);
+	CHECK(byte_ring_pop_bulk(&r, dst, 20) == 16);
+	for (uint8_t i = 0; i < 16; i++) {
+		CHECK(dst[i] == 100 + i);
+	}
+	CHECK(byte_ring_pop_bulk(&r, dst, 20) == 0);
+	CHECK(byte_ring_push_bulk(&r, src, 0) == 0);
+}
+
+static void test_overwrite(void) {
+	element_ring_t r = { 0 };
+	element_t e;
+
+	// Lapping the consumer keeps the newest elements, in order
+	for (uint32_t i = 0; i < 13; i++) {
+		e = element(i);
+		element_ring_push_overwrite(&r, &e);
+	}
+	CHECK(element_ring_count(&r) == 8);
+	for (uint32_t i = 5; i < 13; i++) {
+		CHECK(element_ring_pop(&r, &e) && e.seq == i && e.check == ~i);
+	}
+	CHECK(!element_ring_pop(&r, &e));
+
+	// The producer running far ahead, past where the byte indices wrap
+	for (uint32_t i = 100; i < 1000; i++) {
+		e = element(i);
+		element_ring_push_overwrite(&r, &e);
+	}
+	const element_t* from;
+	CHECK(element_ring_read_span(&r, &from) > 0);
+	CHECK(from[0].seq == 992);
+	for (uint32_t i = 992; i < 1000; i++) {
+		CHECK(element_ring_pop(&r, &e) && e.seq == i);
+	}
+	CHECK(!element_ring_pop(&r, &e));
+
+	// Without overwriting it is a plain queue
+	for (uint32_t i = 0; i < 4; i++) {
+		e = element(i);
+		element_ring_push_overwrite(&r, &e);
+	}
+	CHECK(element_ring_count(&r) == 4);
+	CHECK(element_ring_pop(&r, &e) && e.seq == 0);
+}
+
+static element_ring_t midRing;
+static uint32_t midNext;
+static int midTorn;
+static int midCount;
+
+static void mid_consumer(void) {
+	element_t e;
+	while (element_ring_pop(&midRing, &e)) {
+		if (e.check != ~e.seq || e.seq < midNext) {
+			midTorn++;
+		}
+		midNext = e.seq + 1;
+		midCount++;
+	}
+}
+
+/*
+ * Interrupt a full ring's overwrite at each of its barriers in turn with a
+ * consumer that drains it, as the SPI ISR would the main loop's post
+ */
+static void test_overwrite_interrupted(void) {
+	for (int at = 0; at < 2; at++) {
+		midRing = (element_ring_t){ 0 };
+		midNext = 0;
+		midTorn = 0;
+		midCount = 0;
+		element_t e;
+		for (uint32_t i = 0; i < 8; i++) {
+			e = element(i);
+			element_ring_push_overwrite(&midRing, &e);
+		}
+		interrupt = mid_consumer;
+		interruptAfter = at;
+		e = element(8);
+		element_ring_push_overwrite(&midRing, &e);
+		CHECK(interrupt == NULL);
+		mid_consumer();
+		CHECK(midTorn == 0);
+		// Only the overwritten element 0 is lost, whenever the consumer ran
+		CHECK(midCount == 8 && midNext == 9);
+	}
+}
+
+static stress_ring_t stress;
+static uint32_t stressTotal;
+static uint32_t stressErrors;
+
+// Each side cycles through its single, bulk and span calls
+static void* producer(void* arg) {
+	(void)arg;
+	uint8_t block[13];
+	uint32_t seq = 0;
+	while (seq < stressTotal) {
+		uint32_t left = stressTotal - seq;
+		uint8_t n = 0;
+		if (seq % 3 == 0) {
+			uint8_t b = seq;
+			n = stress_ring_push(&stress, &b);
+		} else if (seq % 3 == 1) {
+			uint8_t want = left < sizeof(block) ? left : sizeof(block);
+			for (uint8_t i = 0; i < want; i++) {
+				block[i] = seq + i;
+			}
+			n = stress_ring_push_bulk(&stress, block, want);
+		} else {
+			uint8_t* at;
+			n = stress_ring_write_span(&stress, &at);
+			if (n > left) {
+				n = left;
+			}
+			for (uint8_t i = 0; i < n; i++) {
+				at[i] = seq + i;
+			}
+			stress_ring_commit(&stress, n);
+		}
+		seq += n;
+		if (!n) {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static void* consumer(void* arg) {
+	(void)arg;
+	uint8_t block[20];
+	uint32_t seq = 0;
+	uint32_t calls = 0;
+	while (seq < stressTotal) {
+		uint8_t n = 0;
+		switch (calls++ % 3) {
+			case 0:
+				n = stress_ring_pop(&stress, block);
+				break;
+			case 1:
+				n = stress_ring_pop_bulk(&stress, block, sizeof(block));
+				break;
+			default: {
+				const uint8_t* at;
+				n = stress_ring_read_span(&stress, &at);
+				for (uint8_t i = 0; i < n; i++) {
+					block[i] = at[i];
+				}
+				stress_ring_release(&stress, n);
+				break;
+			}
+		}
+		for (uint8_t i = 0; i < n; i++, seq++) {
+			if (block[i] != (uint8_t)seq) {
+				stressErrors++;
+			}
+		}
+		if (!n) {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static void test_stress(uint32_t total) {
+	stress = (stress_ring_t){ 0 };
+	stressTotal = total;
+	stressErrors = 0;
+	pthread_t threads[2];
+	pthread_create(&threads[0], NULL, producer, NULL);
+	pthread_create(&threads[1], NULL, consumer, NULL);
+	pthread_join(threads[0], NULL);
+	pthread_join(threads[1], NULL);
+	CHECK(stressErrors == 0);
+	CHECK(stress_ring_count(&stress) == 0);
+}
+
+int main(int argc, char** argv) {
+	uint32_t millions = argc > 1 ? strtoul(argv[1], NULL, 0) : 20;
+
+	test_push_pop();
+	test_wrap();
+	test_spans();
+	test_overwrite();
+	test_overwrite_interrupted();
+	test_stress(millions * 1000000);
+
+	if (failures) {
+		printf("%d failed\n", failures);
+		return 1;
+	}
+	printf("All passed, %u million elements stressed\n", (unsigned)millions);
+	return 0;
+}
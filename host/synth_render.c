@@ -0,0 +1,104 @@
+/*
+ * Offline renderer for the on-device synth
+ *
+ * Builds the firmware's synth engine for the host and plays a short phrase
+ * with every preset patch into a 16-bit mono WAV file. It also times the
+ * engine per sample. Host nanoseconds only compare builds with each other;
+ * the on-target cost is reported by the CDC 'synth' command.
+ *
+ * Build:
+ *   gcc -O2 -DUSE_SYNTH -I../inc -o synth_render synth_render.c ../src/synth.c ../src/wavetable.c
+ *
+ * Usage:
+ *   synth_render [out.wav]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "synth.h"
+
+// Notes of the phrase, each held for NOTE_MS then released for GAP_MS
+static const uint8_t phrase[] = { 60, 64, 67, 72, 67, 64, 60 };
+#define NOTE_MS 180
+#define GAP_MS 70
+#define TAIL_MS 1000
+
+static FILE* out;
+static uint32_t written = 0;
+static double renderNs = 0;
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void put_le(uint32_t value, int bytes) {
+	for (int i = 0; i < bytes; i++) {
+		fputc((value >> (8 * i)) & 0xFF, out);
+	}
+}
+
+static void write_header(uint32_t samples) {
+	fwrite("RIFF", 1, 4, out);
+	put_le(36 + samples * 2, 4);
+	fwrite("WAVEfmt ", 1, 8, out);
+	put_le(16, 4);
+	put_le(1, 2);  // PCM
+	put_le(1, 2);  // mono
+	put_le(SYNTH_RATE, 4);
+	put_le(SYNTH_RATE * 2, 4);
+	put_le(2, 2);
+	put_le(16, 2);
+	fwrite("data", 1, 4, out);
+	put_le(samples * 2, 4);
+}
+
+// Run the engine the way the Timer3 ISR does
+static void render_ms(uint32_t ms) {
+	int16_t buf[SYNTH_CONTROL_SAMPLES];
+	for (uint32_t m = 0; m < ms; m++) {
+		double start = now_ns();
+		for (int i = 0; i < SYNTH_CONTROL_SAMPLES; i++) {
+			buf[i] = (int16_t)((synth_render() - 128) << 8);
+		}
+		synth_control();
+		renderNs += now_ns() - start;
+		for (int i = 0; i < SYNTH_CONTROL_SAMPLES; i++) {
+			put_le((uint16_t)buf[i], 2);
+		}
+		written += SYNTH_CONTROL_SAMPLES;
+	}
+}
+
+int main(int argc, char** argv) {
+	const char* path = argc > 1 ? argv[1] : "synth.wav";
+	out = fopen(path, "wb");
+	if (!out) {
+		perror(path);
+		return 1;
+	}
+	write_header(0);
+
+	for (uint8_t p = 0; p < synth_preset_count(); p++) {
+		synth_preset(p);
+		for (size_t n = 0; n < sizeof(phrase); n++) {
+			synth_note(phrase[n], 100, true);
+			render_ms(NOTE_MS);
+			synth_note(phrase[n], 0, false);
+			render_ms(GAP_MS);
+		}
+		render_ms(TAIL_MS);
+	}
+
+	fseek(out, 0, SEEK_SET);
+	write_header(written);
+	fclose(out);
+	printf("%s: %u samples, %.1f s, %d presets\n", path, written, (double)written / SYNTH_RATE,
+		synth_preset_count());
+	printf("%.1f ns per sample on this host\n", renderNs / written);
+	return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Event stream reader for the USB vendor-specific interface
+ *
+ * Prints each event frame the board sends on its vendor bulk IN endpoint.
+ * The firmware must be built with -DUSE_VENDOR_INTERFACE=ON.
+ *
+ * Build on Linux (needs libusb-1.0-0-dev):
+ *   gcc -O2 -o vendor_reader vendor_reader.c $(pkg-config --cflags --libs libusb-1.0)
+ *
+ * Usage:
+ *   vendor_reader [command bytes...]
+ * Any hex command bytes given (e.g. 0x82) are sent once before streaming.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <libusb.h>
+
+#define VENDOR_ID  0x03EB
+#define PRODUCT_ID 0x2044
+
+#define VENDOR_IN_EP  0x85
+#define VENDOR_OUT_EP 0x06
+
+#define EVENT_FRAME_SYNC 0xA5
+#define EVENT_FRAME_SIZE 8
+
+/* Timer1 runs at 2 MHz on the 16 MHz board */
+#define TICKS_PER_US 2
+
+static const char* event_names[] = { "none", "press", "release", "tap", "hold", "chord" };
+
+static uint8_t crc8_ccitt(uint8_t crc, uint8_t data) {
+	crc ^= data;
+	for (int i = 0; i < 8; i++) {
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+	}
+	return crc;
+}
+
+static int find_vendor_interface(libusb_device_handle* dev) {
+	struct libusb_config_descriptor* config;
+	int found = -1;
+	if (libusb_get_active_config_descriptor(libusb_get_device(dev), &config) != 0) {
+		return -1;
+	}
+	for (int i = 0; i < config->bNumInterfaces && found < 0; i++) {
+		const struct libusb_interface_descriptor* alt = &config->interface[i].altsetting[0];
+		if (alt->bInterfaceClass == LIBUSB_CLASS_VENDOR_SPEC) {
+			found = alt->bInterfaceNumber;
+		}
+	}
+	libusb_free_config_descriptor(config);
+	return found;
+}
+
+static void print_frame(const uint8_t* f) {
+	uint8_t crc = 0;
+	for (int i = 1; i < EVENT_FRAME_SIZE - 1; i++) {
+		crc = crc8_ccitt(crc, f[i]);
+	}
+	if (crc != f[EVENT_FRAME_SIZE - 1]) {
+		printf("bad crc\n");
+		return;
+	}
+	uint32_t ticks = f[3] | (f[4] << 8) | (f[5] << 16) | ((uint32_t)f[6] << 24);
+	const char* name = f[1] < sizeof(event_names) / sizeof(event_names[0]) ? event_names[f[1]] : "?";
+	if (f[1] == 3) {
+		printf("%10.1f us  %-8s %u x%u\n", (double)ticks / TICKS_PER_US, name, f[2] & 0x07, f[2] >> 3);
+	} else if (f[1] == 5) {
+		printf("%10.1f us  %-8s 0x%02x\n", (double)ticks / TICKS_PER_US, name, f[2]);
+	} else {
+		printf("%10.1f us  %-8s %u\n", (double)ticks / TICKS_PER_US, name, f[2]);
+	}
+}
+
+int main(int argc, char** argv) {
+	if (libusb_init(NULL) != 0) {
+		fprintf(stderr, "libusb_init failed\n");
+		return 1;
+	}
+	libusb_device_handle* dev = libusb_open_device_with_vid_pid(NULL, VENDOR_ID, PRODUCT_ID);
+	if (!dev) {
+		fprintf(stderr, "device %04x:%04x not found\n", VENDOR_ID, PRODUCT_ID);
+		return 1;
+	}
+	int iface = find_vendor_interface(dev);
+	if (iface < 0 || libusb_claim_interface(dev, iface) != 0) {
+		fprintf(stderr, "no vendor interface; was the firmware built with USE_VENDOR_INTERFACE?\n");
+		return 1;
+	}
+
+	if (argc > 1) {
+		uint8_t commands[64];
+		int count = 0;
+		for (int i = 1; i < argc && count < (int)sizeof(commands); i++) {
+			commands[count++] = strtoul(argv[i], NULL, 0);
+		}
+		int sent;
+		libusb_bulk_transfer(dev, VENDOR_OUT_EP, commands, count, &sent, 1000);
+	}
+
+	/* Frames never straddle packets, but resync on the sync byte anyway */
+	uint8_t buf[64];
+	uint8_t frame[EVENT_FRAME_SIZE];
+	int have = 0;
+	for (;;) {
+		int len;
+		int r = libusb_bulk_transfer(dev, VENDOR_IN_EP, buf, sizeof(buf), &len, 0);
+		if (r != 0) {
+			fprintf(stderr, "transfer failed: %s\n", libusb_error_name(r));
+			break;
+		}
+		for (int i = 0; i < len; i++) {
+			if (have == 0 && buf[i] != EVENT_FRAME_SYNC) {
+				printf("%02x\n", buf[i]);
+				continue;
+			}
+			frame[have++] = buf[i];
+			if (have == EVENT_FRAME_SIZE) {
+				print_frame(frame);
+				have = 0;
+			}
+		}
+		fflush(stdout);
+	}
+
+	libusb_release_interface(dev, iface);
+	libusb_close(dev);
+	libusb_exit(NULL);
+	return 0;
+}
@@ -294,6 +294,23 @@
 			 */
 			int16_t CDC_Device_ReceiveByte(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo) ATTR_NON_NULL_PTR_ARG(1);
 
+			/** Reads up to \c Length bytes of the current OUT endpoint bank from the host in a single pass. The bank is released
+			 *  back to the USB controller once it has been emptied, so repeated calls drain successive packets. Unlike
+			 *  \ref CDC_Device_ReceiveByte(), the endpoint is only selected and checked once per call rather than once per byte.
+			 *
+			 *  \pre This function must only be called when the Device state machine is in the \ref DEVICE_STATE_Configured state or
+			 *       the call will fail.
+			 *
+			 *  \param[in,out] CDCInterfaceInfo  Pointer to a structure containing a CDC Class configuration and state.
+			 *  \param[out]    Buffer            Pointer to a buffer where the received data is to be stored.
+			 *  \param[in]     Length            Maximum number of bytes to read into the buffer.
+			 *
+			 *  \return Number of bytes read, zero if no data was waiting or a USB host is not connected.
+			 */
+			uint16_t CDC_Device_ReceiveData(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+			                                void* const Buffer,
+			                                const uint16_t Length) ATTR_NON_NULL_PTR_ARG(1) ATTR_NON_NULL_PTR_ARG(2);
+
 			/** Flushes any data waiting to be sent, ensuring that the send buffer is cleared.
 			 *
 			 *  \pre This function must only be called when the Device state machine is in the \ref DEVICE_STATE_Configured state or
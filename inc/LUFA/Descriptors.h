@@ -54,10 +54,78 @@
 		/** Size in bytes of the CDC device-to-host notification IN endpoint. */
 		#define CDC_NOTIFICATION_EPSIZE        8
 
-		/** Size in bytes of the CDC data IN and OUT endpoints. */
-		#define CDC_TXRX_EPSIZE                16
+		/** Size in bytes of the CDC data IN and OUT endpoints. Full speed bulk endpoints may be 8, 16, 32 or 64 bytes. */
+		#if !defined(CDC_TXRX_EPSIZE)
+			#define CDC_TXRX_EPSIZE            64
+		#endif
+
+		/** Number of banks for the CDC data IN and OUT endpoints. With two banks the firmware can fill one while the host
+		 *  drains the other. Both data endpoints together use 2 * CDC_TXRX_BANKS * CDC_TXRX_EPSIZE bytes of the 832 byte
+		 *  endpoint DPRAM on the ATmega32U4.
+		 */
+		#if !defined(CDC_TXRX_BANKS)
+			#define CDC_TXRX_BANKS             2
+		#endif
+
+		#if (CDC_TXRX_EPSIZE > 64) || (CDC_TXRX_EPSIZE & (CDC_TXRX_EPSIZE - 1))
+			#error CDC_TXRX_EPSIZE must be a power of two no larger than 64.
+		#endif
+
+		/** Endpoint address of the vendor-specific bulk IN endpoint, carrying event frames and command responses. */
+		#define VENDOR_IN_EPADDR               (ENDPOINT_DIR_IN  | 5)
+
+		/** Endpoint address of the vendor-specific bulk OUT endpoint, carrying host commands. */
+		#define VENDOR_OUT_EPADDR              (ENDPOINT_DIR_OUT | 6)
+
+		/** Size in bytes of the vendor-specific bulk endpoints. */
+		#define VENDOR_EPSIZE                  64
+
+		#if defined(USE_HID_INTERFACE) || defined(USE_VENDOR_INTERFACE)
+			/** Defined when the device has functions besides CDC, and so groups the CDC interfaces with an interface association. */
+			#define USB_COMPOSITE_DEVICE
+		#endif
+
+		/** Endpoint address of the HID gamepad report IN endpoint. */
+		#define HID_IN_EPADDR                  (ENDPOINT_DIR_IN  | 1)
+
+		/** Size in bytes of the HID gamepad report IN endpoint. */
+		#define HID_EPSIZE                     8
+
+		/** Interval in milliseconds at which the host polls the HID report endpoint. */
+		#define HID_POLLING_INTERVAL_MS        1
+
+		/** Descriptor type of the HID class descriptor. */
+		#define HID_DTYPE_HID                  0x21
+
+		/** Descriptor type of the HID report descriptor. */
+		#define HID_DTYPE_Report               0x22
+
+		/** HID class specific request codes. */
+		enum HID_ClassRequests_t
+		{
+			HID_REQ_GetReport   = 0x01,
+			HID_REQ_GetIdle     = 0x02,
+			HID_REQ_GetProtocol = 0x03,
+			HID_REQ_SetReport   = 0x09,
+			HID_REQ_SetIdle     = 0x0A,
+			HID_REQ_SetProtocol = 0x0B,
+		};
 
 	/* Type Defines: */
+		/** HID class descriptor, giving the HID version implemented and the size of the report descriptor. */
+		typedef struct
+		{
+			USB_Descriptor_Header_t Header;
+
+			uint16_t HIDSpec;
+			uint8_t  CountryCode;
+
+			uint8_t  TotalReportDescriptors;
+
+			uint8_t  HIDReportType;
+			uint16_t HIDReportLength;
+		} ATTR_PACKED USB_HID_Descriptor_HID_t;
+
 		/** Type define for the device configuration descriptor structure. This must be defined in the
 		 *  application code, as the configuration descriptor contains several sub-descriptors which
 		 *  vary between devices, and which describe the device's usage to the host.
@@ -66,6 +134,11 @@
 		{
 			USB_Descriptor_Configuration_Header_t    Config;
 
+			#if defined(USB_COMPOSITE_DEVICE)
+			// CDC Interface Association, so the CDC interfaces bind as one function in a composite device
+			USB_Descriptor_Interface_Association_t   CDC_IAD;
+			#endif
+
 			// CDC Control Interface
 			USB_Descriptor_Interface_t               CDC_CCI_Interface;
 			USB_CDC_Descriptor_FunctionalHeader_t    CDC_Functional_Header;
@@ -77,6 +150,20 @@
 			USB_Descriptor_Interface_t               CDC_DCI_Interface;
 			USB_Descriptor_Endpoint_t                CDC_DataOutEndpoint;
 			USB_Descriptor_Endpoint_t                CDC_DataInEndpoint;
+
+			#if defined(USE_HID_INTERFACE)
+			// HID Gamepad Interface
+			USB_Descriptor_Interface_t               HID_Interface;
+			USB_HID_Descriptor_HID_t                 HID_GamepadHID;
+			USB_Descriptor_Endpoint_t                HID_ReportINEndpoint;
+			#endif
+
+			#if defined(USE_VENDOR_INTERFACE)
+			// Vendor-specific Event Stream Interface
+			USB_Descriptor_Interface_t               VENDOR_Interface;
+			USB_Descriptor_Endpoint_t                VENDOR_DataInEndpoint;
+			USB_Descriptor_Endpoint_t                VENDOR_DataOutEndpoint;
+			#endif
 		} USB_Descriptor_Configuration_t;
 
 		/** Enum for the device interface descriptor IDs within the device. Each interface descriptor
@@ -87,6 +174,13 @@
 		{
 			INTERFACE_ID_CDC_CCI = 0, /**< CDC CCI interface descriptor ID */
 			INTERFACE_ID_CDC_DCI = 1, /**< CDC DCI interface descriptor ID */
+			#if defined(USE_HID_INTERFACE)
+			INTERFACE_ID_HID,         /**< HID gamepad interface descriptor ID */
+			#endif
+			#if defined(USE_VENDOR_INTERFACE)
+			INTERFACE_ID_VENDOR,      /**< Vendor-specific event stream interface descriptor ID */
+			#endif
+			INTERFACE_COUNT,          /**< Total number of interfaces */
 		};
 
 		/** Enum for the device string descriptor IDs within the device. Each string descriptor should
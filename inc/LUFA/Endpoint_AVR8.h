@@ -230,6 +230,31 @@
 				#endif
 			}
 
+			/** Retrieves the size in bytes of one bank of the currently selected endpoint, as configured.
+			 *
+			 *  \ingroup Group_EndpointRW_AVR8
+			 *
+			 *  \return Bank size of the currently selected endpoint, in bytes.
+			 */
+			static inline uint16_t Endpoint_GetEndpointSize(void) ATTR_WARN_UNUSED_RESULT ATTR_ALWAYS_INLINE;
+			static inline uint16_t Endpoint_GetEndpointSize(void)
+			{
+				return (8 << ((UECFG1X & (0x07 << EPSIZE0)) >> EPSIZE0));
+			}
+
+			/** Indicates how many more bytes can be written to the currently selected IN endpoint's bank before
+			 *  it becomes full.
+			 *
+			 *  \ingroup Group_EndpointRW_AVR8
+			 *
+			 *  \return Number of free bytes in the currently selected Endpoint's FIFO buffer.
+			 */
+			static inline uint16_t Endpoint_BytesFreeInEndpoint(void) ATTR_WARN_UNUSED_RESULT ATTR_ALWAYS_INLINE;
+			static inline uint16_t Endpoint_BytesFreeInEndpoint(void)
+			{
+				return (Endpoint_GetEndpointSize() - Endpoint_BytesInEndpoint());
+			}
+
 			/** Determines the currently selected endpoint's direction.
 			 *
 			 *  \return The currently selected endpoint's direction, as a \c ENDPOINT_DIR_* mask.
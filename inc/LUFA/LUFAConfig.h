@@ -43,7 +43,12 @@
 #define _LUFA_CONFIG_H_
 
 		/* General USB Driver Related Tokens: */
-		#define USE_STATIC_OPTIONS               (USB_DEVICE_OPT_FULLSPEED | USB_OPT_REG_ENABLED | USB_OPT_AUTO_PLL)
+		#if defined(USE_SYNTH)
+			/* The synth clocks Timer4 from the PLL, so it starts it and keeps it running */
+			#define USE_STATIC_OPTIONS           (USB_DEVICE_OPT_FULLSPEED | USB_OPT_REG_ENABLED | USB_OPT_MANUAL_PLL)
+		#else
+			#define USE_STATIC_OPTIONS           (USB_DEVICE_OPT_FULLSPEED | USB_OPT_REG_ENABLED | USB_OPT_AUTO_PLL)
+		#endif
 		#define USB_DEVICE_ONLY
 
 		/* USB Device Mode Driver Related Tokens: */
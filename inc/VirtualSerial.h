@@ -37,8 +37,25 @@
 #include <string.h>
 #include <stdio.h>
 
+#include "command.h"
+#include "config.h"
+#include "counters.h"
+#include "ga.h"
+#include "gesture.h"
+#include "hid.h"
 #include "i2cmaster.h"
+#include "latency.h"
 #include "mcp23017.h"
+#include "prng.h"
+#include "protocol.h"
+#include "sched.h"
+#include "seq.h"
+#include "sof.h"
+#include "synth.h"
+#include "tempo.h"
+#include "timer.h"
+#include "trace.h"
+#include "vendor.h"
 
 #include "LUFA/Descriptors.h"
 #include "LUFA/LEDs.h"
@@ -48,6 +65,15 @@
 #define LED_USB_CONN LEDS_LED2
 #define LED_INPUT LEDS_LED3
 
+/** How long the input LED stays lit after a press. */
+#define LED_INPUT_MS 20
+
+/** Period of the status log flush while the host is connected. */
+#define LOG_FLUSH_MS 50
+
+/** Status messages held until the host opens the port; start-up queues up to 12. */
+#define LOG_ENTRIES 12
+
 /** LED mask for the library LED driver, to indicate that the USB interface is not ready. */
 #define LEDMASK_USB_NOTREADY      LED_POWER
 
@@ -70,13 +96,12 @@
 #define DD_SS 0
 #define SS   PB0 // active low
 
-unsigned long millis(void);
-
 void SetupHardware(void);
 
 void EVENT_USB_Device_Connect(void);
 void EVENT_USB_Device_Disconnect(void);
 void EVENT_USB_Device_ConfigurationChanged(void);
 void EVENT_USB_Device_ControlRequest(void);
+void EVENT_USB_Device_StartOfFrame(void);
 #endif
 
@@ -0,0 +1,33 @@
+/*
+ * CDC command interpreter
+ *
+ * Bytes from the host are pulled a whole endpoint bank at a time into a
+ * receive ring, then split into lines and dispatched by their first word.
+ */
+
+#ifndef COMMAND_H_
+#define COMMAND_H_
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "LUFA/USB.h"
+
+// Must be a power of two no larger than 128, see ring.h. One full CDC
+// packet; anything more waits in the endpoint bank.
+#define COMMAND_RX_SIZE 64
+#define COMMAND_LINE_MAX 64
+
+/*!
+ * Copy whatever the host has sent into the receive ring.
+ * Returns the number of bytes now waiting to be parsed.
+ */
+uint8_t command_receive(USB_ClassInfo_CDC_Device_t* cdc);
+
+/*!
+ * Parse the receive ring and run any complete command lines
+ * FILE* out Stream for command output
+ */
+void command_process(FILE* out);
+
+#endif /* COMMAND_H_ */
@@ -0,0 +1,120 @@
+/*
+ * Runtime configuration
+ *
+ * Tunable settings live in one RAM block so they can be changed while the
+ * rig is running. Each one is described by a PROGMEM parameter table entry
+ * giving its name, type, range and the hook that applies a new value.
+ *
+ * Saved settings go into a ring of EEPROM slots, each tagged with a
+ * sequence number and a CRC. A save writes the slot after the newest one,
+ * spreading wear across the ring. An interrupted save leaves the previous
+ * slot intact.
+ */
+
+#ifndef CONFIG_H_
+#define CONFIG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#include "midi.h"
+
+// Bump when config_t changes so old EEPROM contents are ignored
+#define CONFIG_VERSION 7
+// EEPROM slots in the save ring, fewer than 256
+#define CONFIG_SLOTS 16
+
+// Defaults, used until changed with the CDC 'set' command or loaded from EEPROM
+#define CONFIG_DEBOUNCE_MS 50
+#define CONFIG_I2C_KHZ 100
+#define CONFIG_HID_MS 1
+#define CONFIG_VENDOR_MS 1
+#define CONFIG_NOTE_BASE 60
+#define CONFIG_VELOCITY 0x7F
+#define CONFIG_SCALE 0  // SCALE_CHROMATIC
+// Longer than the debounce window, which holds back a chord's later presses
+#define CONFIG_CHORD_MS 80
+#define CONFIG_HOLD_MS 500
+#define CONFIG_TAP_MS 250
+#define CONFIG_BPM 120
+
+typedef struct {
+	// edges closer together than this are treated as switch bounce
+	uint16_t debounceMs;
+	// nominal bit-banged I2C clock
+	uint16_t i2cKhz;
+	// HID report and vendor stream task periods
+	uint8_t hidMs;
+	uint8_t vendorMs;
+	// MIDI note of input 0, and note-on velocity
+	uint8_t noteBase;
+	uint8_t velocity;
+	// Note mapping: scale_t, semitone shift and MIDI channel
+	uint8_t scale;
+	int8_t transpose;
+	uint8_t channel;
+	// Gesture windows: presses gathered into a chord, press length that
+	// counts as a hold, and the longest gap between taps of a multi-tap
+	uint16_t chordMs;
+	uint16_t holdMs;
+	uint16_t tapMs;
+	// Run the on-device genetic algorithm
+	uint8_t evolve;
+	// Sequencer: seq_mode_t, tempo, and 1 to follow the clock from the Pi
+	uint8_t arp;
+	uint8_t bpm;
+	uint8_t clock;
+	// Set the sequencer tempo from the tap tempo estimate
+	uint8_t follow;
+	// Per-input note, channel and velocity, MIDI_DEFAULT to follow the above
+	midi_input_t inputs[MIDI_INPUTS];
+} config_t;
+
+extern config_t config;
+
+// Half period loop count read by i2c_delay_T2 in i2cmaster.S
+extern uint8_t i2c_half_period;
+
+/*!
+ * Load the newest valid saved settings from EEPROM, or the defaults
+ * Returns false if nothing valid was saved
+ */
+bool config_load(void);
+
+/*!
+ * Save the current settings to the next EEPROM slot
+ */
+void config_save(void);
+
+/*!
+ * Restore the defaults in RAM and apply them. The saved copy is untouched.
+ */
+void config_defaults(void);
+
+/*!
+ * Push every setting out to the hardware and scheduler. Call once at boot.
+ */
+void config_apply(void);
+
+uint8_t config_count(void);
+
+/*!
+ * Look up a parameter by name
+ * Returns its index, or config_count() if there is no such parameter
+ */
+uint8_t config_find(const char* name);
+
+PGM_P config_name(uint8_t index);
+
+int16_t config_get(uint8_t index);
+
+/*!
+ * Range check a new value, store it and apply it immediately
+ * Returns false, leaving the setting unchanged, if it is out of range
+ */
+bool config_set(uint8_t index, int16_t value);
+
+void config_range(uint8_t index, int16_t* min, int16_t* max);
+
+#endif /* CONFIG_H_ */
@@ -0,0 +1,63 @@
+/*
+ * Usage counters
+ *
+ * Cheap saturating counters of how the rig is used and how close its
+ * queues run to full, for capacity planning and wear analysis from the
+ * field. They live in one struct, so SPI or CDC can read them in a single
+ * atomic burst, and they count from boot or the last reset.
+ */
+
+#ifndef COUNTERS_H_
+#define COUNTERS_H_
+
+#include <stdint.h>
+#include <util/atomic.h>
+
+#include "event.h"
+
+#define COUNTERS_INPUTS 8
+
+typedef struct {
+	uint32_t ms;                           // since the counters were reset
+	uint16_t presses[COUNTERS_INPUTS];
+	uint32_t events;                       // queued, of every type
+	uint32_t spiCommands;
+	uint16_t i2cErrors;                    // NAKs from the MCP23017
+	uint8_t usbConnects;
+	// High-water marks of the queues, in entries
+	uint8_t eventHigh[EVENT_READERS];      // per reader; EVENT_QUEUE_SIZE means it lost events
+	uint8_t commandHigh;                   // CDC receive ring
+	uint8_t midiHigh;                      // MIDI out
+} counters_t;
+
+extern counters_t counters;
+
+/*!
+ * Add one to a counter, sticking at its maximum. Safe in ISRs and the
+ * main loop.
+ */
+#define COUNTERS_INC(field) \
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { \
+		if ((__typeof__(counters.field))(counters.field + 1) != 0) { \
+			counters.field++; \
+		} \
+	}
+
+/*!
+ * Raise a high-water mark to value
+ */
+#define COUNTERS_HIGH(field, value) \
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) { \
+		if ((value) > counters.field) { \
+			counters.field = (value); \
+		} \
+	}
+
+/*!
+ * Copy the counters. Safe to call from ISRs.
+ */
+void counters_snapshot(counters_t* out);
+
+void counters_reset(void);
+
+#endif /* COUNTERS_H_ */
@@ -0,0 +1,67 @@
+/*
+ * Input event queue
+ *
+ * Timestamped input events, framed identically for every transport. Each
+ * transport has its own queue, so SPI and USB see the same stream. A
+ * reader that falls more than EVENT_QUEUE_SIZE events behind loses the
+ * oldest ones.
+ *
+ * Frame layout (EVENT_FRAME_SIZE bytes):
+ *   0     EVENT_FRAME_SYNC
+ *   1     type (EVENT_*)
+ *   2     data (input index for presses and releases, see gesture.h for the rest)
+ *   3..6  Timer1 timestamp, little-endian
+ *   7     CRC-8 (CCITT) of bytes 1..6
+ */
+
+#ifndef EVENT_H_
+#define EVENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per reader; must be a power of two no larger than 128, see ring.h. Both
+// queues together take the RAM the one shared queue of 32 used to.
+#define EVENT_QUEUE_SIZE 16
+
+#define EVENT_FRAME_SYNC 0xA5
+#define EVENT_FRAME_SIZE 8
+
+enum {
+	EVENT_NONE = 0,  // queue empty
+	EVENT_PRESS,
+	EVENT_RELEASE,
+	EVENT_TAP,
+	EVENT_HOLD,
+	EVENT_CHORD,
+};
+
+enum {
+	EVENT_READER_SPI = 0,
+	EVENT_READER_USB,
+	EVENT_READERS
+};
+
+typedef struct {
+	uint8_t type;
+	uint8_t data;
+	uint32_t time;
+} event_t;
+
+/*!
+ * Queue an event. Call from the main loop only, the single producer.
+ */
+void event_post(uint8_t type, uint8_t data, uint32_t time);
+
+/*!
+ * Take the next event for a reader. Returns false if there is none.
+ */
+bool event_pop(uint8_t reader, event_t* out);
+
+/*!
+ * Encode an event as a frame
+ * uint8_t* frame Buffer of at least EVENT_FRAME_SIZE bytes
+ */
+void event_frame(const event_t* e, uint8_t* frame);
+
+#endif /* EVENT_H_ */
@@ -0,0 +1,70 @@
+/*
+ * Interaction features
+ *
+ * Rolling statistics of how the inputs are being played, kept on the AVR
+ * where the edge timestamps are exact. The genetic algorithm reads them as
+ * one compact summary frame instead of reconstructing them from polls.
+ *
+ * Press counts cover the last FEATURE_WINDOW_S seconds. Inter-onset
+ * intervals and hold times are exponentially weighted with a weight of
+ * 1/8, and gaps longer than FEATURE_IOI_MAX_MS start a new phrase rather
+ * than count as an interval. Chord counts record pairs of inputs that
+ * sounded together and are halved every window.
+ */
+
+#ifndef FEATURE_H_
+#define FEATURE_H_
+
+#include <stdint.h>
+
+#define FEATURE_INPUTS 8
+#define FEATURE_WINDOW_S 8
+#define FEATURE_IOI_MAX_MS 2000
+// Presses this close together count as a chord even if neither is held
+#define FEATURE_CHORD_MS 30
+// Per-input times in the summary are in these units, saturating at 255
+#define FEATURE_UNIT_MS 8
+// How often the summary frame is rebuilt
+#define FEATURE_REFRESH_MS 100
+
+#define FEATURE_PAIRS (FEATURE_INPUTS * (FEATURE_INPUTS - 1) / 2)
+
+typedef struct {
+	uint8_t presses;  // in the window, saturating
+	uint8_t ioiMean;  // FEATURE_UNIT_MS
+	uint8_t ioiSd;    // FEATURE_UNIT_MS
+	uint8_t hold;     // mean hold duration, FEATURE_UNIT_MS
+} feature_input_t;
+
+typedef struct {
+	// All inputs together
+	uint16_t presses;
+	uint16_t ioiMean;  // ms
+	uint16_t ioiSd;    // ms
+	feature_input_t input[FEATURE_INPUTS];
+	// 4-bit saturating counts for each pair (i, j), i < j, in the order
+	// (0,1) (0,2) ... (0,7) (1,2) ..., two to a byte, low nibble first
+	uint8_t chords[FEATURE_PAIRS / 2];
+} feature_t;
+
+/*!
+ * Feed in the debounced input level after it changes
+ * uint8_t state Inputs now pressed
+ * uint8_t changed Inputs that changed
+ * uint32_t time Timer1 timestamp of the change
+ */
+void feature_input(uint8_t state, uint8_t changed, uint32_t time);
+
+/*!
+ * Age the window and rebuild the summary. Runs every FEATURE_REFRESH_MS.
+ */
+void feature_task(void);
+
+/*!
+ * Copy out the latest summary. Safe to call from an ISR.
+ */
+void feature_snapshot(feature_t* out);
+
+void feature_reset(void);
+
+#endif /* FEATURE_H_ */
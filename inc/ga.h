@@ -0,0 +1,85 @@
+/*
+ * Genetic algorithm
+ *
+ * A small on-device GA, so the rig keeps evolving its sound without the Pi.
+ * Genomes are 32-bit packed fields (see GENOME_* below). Each generation is
+ * bred with binary tournament selection, uniform crossover and per-bit
+ * mutation, keeping the best genome unchanged. All memory is static.
+ *
+ * Breeding is incremental: ga_breed() makes one child per call, so it can
+ * run in the gaps between input events. Fitness comes from outside. On the
+ * device each genome is expressed in turn (note mapping, and synth patch
+ * when built with USE_SYNTH) and scored from the interaction features
+ * gathered while it played.
+ */
+
+#ifndef GA_H_
+#define GA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Must be a power of two
+#define GA_POPULATION 16
+// Per-bit mutation probability is 1 / 2^GA_MUTATION_SHIFT
+#define GA_MUTATION_SHIFT 5
+// How long each genome plays before it is scored
+#define GA_EVAL_MS 8000
+#define GA_TICK_MS 50
+
+typedef uint32_t genome_t;
+
+// Genome fields: shift and width in bits
+#define GENOME_FIELD(g, shift, bits) (((g) >> (shift)) & ((1UL << (bits)) - 1))
+#define GENOME_WAVE(g)      GENOME_FIELD(g, 0, 2)
+#define GENOME_ATTACK(g)    GENOME_FIELD(g, 2, 4)
+#define GENOME_DECAY(g)     GENOME_FIELD(g, 6, 4)
+#define GENOME_SUSTAIN(g)   GENOME_FIELD(g, 10, 4)
+#define GENOME_RELEASE(g)   GENOME_FIELD(g, 14, 4)
+#define GENOME_SCALE(g)     GENOME_FIELD(g, 18, 3)
+#define GENOME_TRANSPOSE(g) ((int8_t)(GENOME_FIELD(g, 21, 5) << 3) >> 3)
+#define GENOME_DETUNE(g)    GENOME_FIELD(g, 26, 3)
+
+typedef struct {
+	uint16_t generation;
+	uint8_t current;     // genome being played
+	genome_t genome;     // its value
+	uint16_t bestFitness;
+	genome_t best;       // best of the last complete generation
+} ga_status_t;
+
+/*!
+ * Fill the population with random genomes from the prng.h stream
+ */
+void ga_reset(void);
+
+genome_t ga_individual(uint8_t index);
+
+void ga_set_fitness(uint8_t index, uint16_t fitness);
+
+/*!
+ * Breed the next child of the next generation
+ * Returns true when the new generation is complete and has replaced the old
+ */
+bool ga_breed(void);
+
+uint16_t ga_generation(void);
+
+/*!
+ * Apply a genome: scale and transposition, and the synth patch in
+ * USE_SYNTH builds
+ */
+void ga_express(genome_t g);
+
+/*!
+ * Express, score and breed on the device. Runs every GA_TICK_MS while
+ * evolution is switched on with the 'evolve' parameter.
+ */
+void ga_task(void);
+
+/*!
+ * Safe to call from an ISR: ga_task publishes the status whole
+ */
+void ga_status(ga_status_t* out);
+
+#endif /* GA_H_ */
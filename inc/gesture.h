@@ -0,0 +1,43 @@
+/*
+ * Gesture recogniser
+ *
+ * Turns the debounced edge stream into musically meaningful events, posted
+ * to the event queue alongside the raw presses and releases:
+ *
+ *   EVENT_CHORD  two or more inputs pressed within the chord window
+ *                (data: mask of the inputs)
+ *   EVENT_TAP    one or more short presses of an input, each following the
+ *                last release within the tap gap (data: count << 3 | input)
+ *   EVENT_HOLD   an input held past the hold threshold (data: input)
+ *
+ * Each gesture is stamped with the time of the press that started it.
+ * Inputs that are part of a chord do not also produce taps or holds.
+ */
+
+#ifndef GESTURE_H_
+#define GESTURE_H_
+
+#include <stdint.h>
+
+#define GESTURE_INPUTS 8
+// Timeouts are checked this often while any gesture is in progress
+#define GESTURE_TICK_MS 5
+
+#define GESTURE_TAP_INPUT(data) ((data) & 0x07)
+#define GESTURE_TAP_COUNT(data) ((data) >> 3)
+
+/*!
+ * Feed in the debounced input level after it changes
+ * uint8_t state Inputs now pressed
+ * uint8_t changed Inputs that changed
+ * uint32_t time Timer1 timestamp of the change
+ */
+void gesture_input(uint8_t state, uint8_t changed, uint32_t time);
+
+/*!
+ * Close gestures whose windows have run out. Runs every GESTURE_TICK_MS
+ * while anything is in progress, then stops itself.
+ */
+void gesture_task(void);
+
+#endif /* GESTURE_H_ */
@@ -0,0 +1,29 @@
+/*
+ * USB HID gamepad
+ *
+ * Optional (USE_HID_INTERFACE) second USB function that presents the buttons
+ * as an 8-button gamepad, so a host can read them without opening the CDC
+ * port. Reports go out on a 1 ms interrupt endpoint only when the state
+ * changes.
+ */
+
+#ifndef HID_H_
+#define HID_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool hid_configure_endpoints(void);
+void hid_process_control_request(void);
+
+/*!
+ * uint8_t state Debounced button state, one bit per held button
+ */
+void hid_set_state(uint8_t state);
+
+/*!
+ * Send a report if the state has changed since the last one
+ */
+void hid_task(void);
+
+#endif /* HID_H_ */
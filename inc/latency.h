@@ -0,0 +1,40 @@
+/*
+ * Press-to-host latency histogram
+ *
+ * Each input edge is timestamped when INT2 captures it, and again when the
+ * byte carrying it leaves the device (clocked out over SPI or written to a
+ * USB endpoint). The difference, in Timer1 ticks, is counted in a log2
+ * bucket: bucket n holds latencies in [2^n, 2^(n+1)) ticks, with the last
+ * bucket open-ended.
+ */
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <stdint.h>
+
+#define LATENCY_BUCKETS 24
+
+typedef struct {
+	// saturating counts per log2 bucket
+	uint16_t bucket[LATENCY_BUCKETS];
+	// largest latency seen, in Timer1 ticks
+	uint32_t max;
+} latency_histogram_t;
+
+/*!
+ * Record an input edge. Only the oldest edge not yet sent is kept, since
+ * later edges are merged into the same outgoing report.
+ * uint32_t ticks Timer1 timestamp taken when the edge was captured
+ */
+void latency_capture(uint32_t ticks);
+
+/*!
+ * The pending input has left the device; bin its latency.
+ */
+void latency_sent(void);
+
+void latency_reset(void);
+void latency_snapshot(latency_histogram_t* out);
+
+#endif /* LATENCY_H_ */
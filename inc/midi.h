@@ -9,8 +9,31 @@
 #ifndef MIDI_H_
 #define MIDI_H_
 
+#include <stdbool.h>
 #include <stdint.h>
-#include <stdlib.h>
+#include <avr/pgmspace.h>
+
+// Inputs on the MCP23017 port
+#define MIDI_INPUTS 8
+
+// MIDI out on USART1 TX (PD3). RX would be PD2, which is taken by INT2.
+#define MIDI_BAUD 31250
+#define MIDI_TX_SIZE 32  // power of two, see ring.h
+
+// System real-time messages
+#define MIDI_CLOCK 0xF8
+#define MIDI_START 0xFA
+#define MIDI_STOP 0xFC
+
+// Per-input override field that follows the scale, channel or velocity setting
+#define MIDI_DEFAULT 0xFF
+
+// One input's overrides of the mapping, saved with the config
+typedef struct {
+	uint8_t note;
+	uint8_t channel;
+	uint8_t velocity;
+} midi_input_t;
 
 // a struct to hold the note info
 struct _midi {
@@ -21,13 +44,101 @@ struct _midi {
 };
 typedef struct _midi midi_t;
 
+// Scales the inputs are laid out on, lowest input first
+typedef enum {
+	SCALE_CHROMATIC,
+	SCALE_MAJOR,
+	SCALE_MINOR,
+	SCALE_PENTATONIC,
+	SCALE_MINOR_PENTATONIC,
+	SCALE_BLUES,
+	SCALE_DORIAN,
+	SCALE_WHOLE_TONE,
+	SCALE_COUNT,
+} scale_t;
+
 /*!
+ * Fill in the MIDI message for an input changing. Costs one table lookup.
  * uint8_t index A 0-based index of the input index
  * uint8_t on If 0, off, otherwise on.
+ * midi_t* r Message to fill in
+ */
+void Midi(uint8_t index, uint8_t on, midi_t* r);
+
+/*!
+ * Rebuild the per-input note, channel and velocity tables from the root
+ * note, scale, transposition, channel, velocity and per-input overrides in
+ * config. Called whenever one of them changes.
+ */
+void midi_remap(void);
+
+/*!
+ * Play a scale and transposition chosen by the GA without touching config,
+ * so saving keeps the player's own. Lasts until midi_release().
+ */
+void midi_express(uint8_t scale, int8_t transpose);
+
+/*!
+ * Go back to config's scale and transposition and remap. Evolution
+ * stopping, a preset, and setting the scale or transposition all release.
+ */
+void midi_release(void);
+
+/*!
+ * Set an input's overrides and remap. Override notes are transposed along
+ * with the scale.
+ * Returns false, changing nothing, if the input or a field is out of range
+ */
+bool midi_map(uint8_t input, const midi_input_t* map);
+
+/*!
+ * The note, channel and velocity an input currently plays
  */
-midi_t* Midi(uint8_t index, uint8_t on);
+void midi_mapped(uint8_t input, midi_input_t* out);
 
-// eventually need a way to transmit the midi info via some protocol(s)
+uint8_t midi_preset_count(void);
 
+PGM_P midi_preset_name(uint8_t preset);
+
+/*!
+ * Switch to one of the flash presets, which sets the root note, scale,
+ * channel and per-input overrides and clears the transposition
+ * Returns false if there is no such preset
+ */
+bool midi_preset(uint8_t preset);
+
+/*!
+ * Replace the input to note table outright, until the next remap
+ * const uint8_t* notes MIDI_INPUTS note numbers
+ */
+void midi_set_notes(const uint8_t* notes);
+
+/*!
+ * Shift every note by a number of semitones, replacing the current shift
+ */
+void midi_transpose(int8_t semitones);
+
+/*!
+ * Set up USART1 as a transmit-only MIDI port
+ */
+void midi_out_init(void);
+
+/*!
+ * Queue a byte for MIDI out. With the port idle it goes straight into the
+ * transmit register, so a message sent from an ISR leaves at once. Safe
+ * to call from ISRs.
+ * Returns false, dropping the byte, if the queue is full
+ */
+bool midi_out(uint8_t b);
+
+/*!
+ * Queue a three byte message for MIDI out
+ */
+void midi_out_message(const midi_t* m);
+
+/*!
+ * Bytes dropped with the transmit queue full
+ */
+uint16_t midi_out_overruns(void);
 
-#endif /* MIDI_H_ */
\ No newline at end of file
+#endif /* MIDI_H_ */
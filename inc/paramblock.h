@@ -0,0 +1,74 @@
+/*
+ * Parameter block upload
+ *
+ * Lets the Pi replace a whole parameter set over SPI without output ever
+ * seeing half of it. After the CMD_PARAMBLOCK command byte, every SPI byte
+ * is data, even with the top bit set, until the block is complete:
+ *
+ *   type, length, length data bytes, CRC-16 (_crc_ccitt_update, 0xFFFF
+ *   start) of type, length and data, low byte first
+ *
+ * The bytes may be spread over several transfers, as long as no gap is
+ * longer than PARAMBLOCK_TIMEOUT_MS. They land in a shadow buffer. Once
+ * the CRC checks out, the next Timer1 tick swaps the shadow and live
+ * buffer pointers, and a task then hands the new block to its consumer.
+ *
+ * The byte clocked out after the last CRC byte is a PARAMBLOCK_* status.
+ */
+
+#ifndef PARAMBLOCK_H_
+#define PARAMBLOCK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PARAMBLOCK_MAX 32
+#define PARAMBLOCK_TIMEOUT_MS 50
+
+// Block types
+enum {
+	PARAMBLOCK_SYNTH_PATCH = 1,  // synth_patch_t (USE_SYNTH builds)
+	PARAMBLOCK_NOTES,            // MIDI note for each input
+	PARAMBLOCK_GENOME,           // genome_t, little-endian, expressed as the GA would
+};
+
+// Status after the last byte
+enum {
+	PARAMBLOCK_BUSY = 0,        // more bytes expected
+	PARAMBLOCK_OK,              // committed at the next tick
+	PARAMBLOCK_BAD_CRC,
+	PARAMBLOCK_BAD_LENGTH,
+	PARAMBLOCK_PENDING,         // the previous block has not been swapped in yet
+};
+
+typedef struct {
+	uint8_t type;
+	uint8_t length;
+	uint8_t data[PARAMBLOCK_MAX];
+} paramblock_t;
+
+/*!
+ * Start receiving a block. Called from the SPI ISR on CMD_PARAMBLOCK.
+ */
+void paramblock_begin(void);
+
+bool paramblock_receiving(void);
+
+/*!
+ * Take the next byte of a block. Called from the SPI ISR.
+ * Returns the PARAMBLOCK_* status to clock out next
+ */
+uint8_t paramblock_receive(uint8_t byte);
+
+/*!
+ * Swap in a validated block and expire stalled uploads. Called from the
+ * Timer1 ISR every millisecond.
+ */
+void paramblock_tick(void);
+
+/*!
+ * Hand the block just swapped in to its consumer
+ */
+void paramblock_task(void);
+
+#endif /* PARAMBLOCK_H_ */
@@ -0,0 +1,69 @@
+/*
+ * Pseudo-random numbers
+ *
+ * xorshift32: three shifts and XORs per number, 2^32 - 1 period. Not for
+ * anything security related.
+ *
+ * The state is seeded at boot from ADC noise, and then keeps being
+ * stirred with the low bits of Timer1 at events whose timing the AVR does
+ * not control: INT2 edges and USB start-of-frames. Each sample is credited
+ * with one bit, and every PRNG_POOL_SAMPLES samples the pool is folded
+ * into the generator state.
+ */
+
+#ifndef PRNG_H_
+#define PRNG_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define PRNG_POOL_SAMPLES 32
+// Random bytes handed out at once by prng_take
+#define PRNG_BLOCK_BYTES 32
+// ADC conversions read at boot, 13 ADC clocks (104 us) each
+#define PRNG_BOOT_SAMPLES 64
+
+typedef struct {
+	uint32_t samples;  // entropy samples stirred in since boot
+	uint16_t reseeds;  // times the pool has been folded into the state
+} prng_stats_t;
+
+/*!
+ * Seed from the LSB noise of the ADC reading the internal temperature
+ * sensor, then switch the ADC off again
+ */
+void prng_init(void);
+
+/*!
+ * Restart the sequence. A zero seed is replaced, as zero is a fixed point.
+ */
+void prng_seed(uint32_t seed);
+
+/*!
+ * Mix in an entropy sample. Cheap enough for ISRs.
+ */
+void prng_stir(uint8_t sample);
+
+uint32_t prng_next(void);
+
+/*!
+ * Fill a buffer with random bytes
+ */
+void prng_fill(uint8_t* buf, uint8_t len);
+
+/*!
+ * Make the next block for prng_take, if the last one has been taken. Runs
+ * the generator eight times, so leave it to the main loop.
+ */
+void prng_refill(void);
+
+/*!
+ * Copy out the block prng_refill made, for ISRs that can't spend the time
+ * generating it. A block taken again before the next refill comes out as
+ * PRNG_BLOCK_BYTES zeros. Returns false in that case
+ */
+bool prng_take(uint8_t* out);
+
+void prng_stats(prng_stats_t* out);
+
+#endif /* PRNG_H_ */
@@ -0,0 +1,81 @@
+/*
+ * Host command protocol
+ *
+ * Single-byte commands shared by the SPI slave and the USB vendor interface.
+ * Commands have the top bit set. Over SPI the response is clocked out on the
+ * following transfers; over USB it is written to the vendor IN endpoint.
+ */
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "counters.h"
+#include "event.h"
+#include "feature.h"
+#include "ga.h"
+#include "latency.h"
+#include "midi.h"
+#include "paramblock.h"
+#include "prng.h"
+#include "sched.h"
+#include "seq.h"
+#include "sof.h"
+#include "synth.h"
+#include "tempo.h"
+#include "timer.h"
+
+#define CMD_MASK          0x80
+#define CMD_BUTTONS       0x80  // buttons pressed since the last poll
+#define CMD_LATENCY       0x81  // latency_histogram_t, little-endian
+#define CMD_LATENCY_RESET 0x82
+#define CMD_SLEEP_STATS   0x83  // sched_stats_t since the last read, then reset
+#define CMD_EVENT         0x84  // next event frame, type EVENT_NONE if the queue is empty
+#define CMD_SOF           0x85  // sof_latch_t: latest USB frame number against Timer1
+#define CMD_SYNC          0x86  // uint32_t Timer1 latched as the command byte arrives
+#define CMD_FEATURES      0x87  // feature_t summary frame
+#define CMD_GA            0x88  // ga_status_t
+#define CMD_PARAMBLOCK    0x89  // SPI only: the following bytes are a parameter block, see paramblock.h
+#define CMD_RANDOM        0x8A  // PROTOCOL_RANDOM_BYTES random bytes
+#define CMD_SEQ           0x8B  // seq_stats_t
+#define CMD_CLOCK         0x8C  // one 24 PPQN pulse of external clock for the sequencer
+#define CMD_TEMPO         0x8D  // tempo_t tap tempo estimate
+#define CMD_COUNTERS      0x8E  // counters_t usage counters
+#define CMD_COUNTERS_RESET 0x8F
+
+// Commands carrying their argument in the low bits
+#define CMD_PRESET        0x90  // 0x90 | n: switch to note mapping preset n
+#define CMD_TRANSPOSE     0xA0  // 0xA0 | t: transpose by t semitones, 5-bit two's complement
+#define CMD_SYNTH_PATCH   0xC0  // 0xC0 | n: switch the synth to preset patch n (USE_SYNTH)
+#define CMD_ARG_MASK      0x1F
+
+// Largest response to any command
+#define PROTOCOL_MAX_RESPONSE sizeof(latency_histogram_t)
+#define PROTOCOL_RANDOM_BYTES PRNG_BLOCK_BYTES
+
+// Presses accumulated for CMD_BUTTONS, owned by VirtualSerial.c
+extern volatile uint8_t buttons;
+
+/*!
+ * Run a command
+ * uint8_t reader Event queue cursor (EVENT_READER_*) of the calling transport
+ * uint8_t* response Buffer of at least PROTOCOL_MAX_RESPONSE bytes
+ * Returns the length of the response
+ */
+uint8_t protocol_command(uint8_t command, uint8_t reader, uint8_t* response);
+
+/*!
+ * Response to CMD_SYNC with a Timer1 value the transport latched itself.
+ * The SPI ISR latches it on entry, before anything else can add delay.
+ */
+uint8_t protocol_sync(uint32_t ticks, uint8_t* response);
+
+/*!
+ * Whether a command's response reports a press. The transport calls
+ * latency_sent() once the whole response has left the device.
+ */
+bool protocol_carries_press(uint8_t command, const uint8_t* response);
+
+#endif /* PROTOCOL_H_ */
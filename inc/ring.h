@@ -0,0 +1,181 @@
+/*
+ * Single-producer, single-consumer ring buffers
+ *
+ * RING_DEFINE(name, type, size); defines name_t, a ring of size elements
+ * of type, and its functions name_push, name_pop and so on. One side can
+ * run in an ISR and the other in the main loop without masking interrupts:
+ * only the producer writes head and only the consumer writes tail, and
+ * both are single bytes, which the AVR reads and writes atomically. A
+ * compiler barrier keeps each element's copy on the right side of the
+ * index update that hands it over.
+ *
+ * The indices run free and are masked on use, so size must be a power of
+ * two, and at most 128 so that head - tail always fits in a byte. With
+ * more than one producer or consumer, each side must serialise its own
+ * callers, for example with ATOMIC_BLOCK.
+ *
+ * name_push_overwrite drops the oldest element instead of the new one. It
+ * still leaves tail to the consumer: it publishes where the consumer should
+ * resume and raises a flag, which the consumer's next pop or read_span
+ * honours before reading. That handshake needs the producer never to run
+ * in the middle of the consumer, so the consumer must be the ISR side, or
+ * share the producer's context. Don't mix it with name_push on one ring.
+ */
+
+#ifndef RING_H_
+#define RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Orders element copies against index updates. A compiler barrier is all
+// the single-core AVR needs; a host build running the two sides on
+// different cores defines a hardware fence first.
+#ifndef RING_BARRIER
+#define RING_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+#endif
+
+#define RING_DEFINE(name, type, size) \
+	typedef struct { \
+		type buf[size]; \
+		volatile uint8_t head;  /* free-running, written by the producer */ \
+		volatile uint8_t tail;  /* free-running, written by the consumer */ \
+		volatile uint8_t resume;    /* first element left after an overwrite */ \
+		volatile bool overwritten;  /* set by the producer, cleared by the consumer */ \
+	} name##_t; \
+	\
+	static inline uint8_t name##_count(const name##_t* r) { \
+		/* tail is stale until the consumer resyncs */ \
+		return r->overwritten ? (size) : (uint8_t)(r->head - r->tail); \
+	} \
+	\
+	static inline uint8_t name##_space(const name##_t* r) { \
+		return (size) - name##_count(r); \
+	} \
+	\
+	/* Returns false, leaving the ring unchanged, if it is full */ \
+	static inline bool name##_push(name##_t* r, const type* v) { \
+		uint8_t head = r->head; \
+		if ((uint8_t)(head - r->tail) == (size)) { \
+			return false; \
+		} \
+		r->buf[head & ((size) - 1)] = *v; \
+		RING_BARRIER(); \
+		r->head = head + 1; \
+		return true; \
+	} \
+	\
+	/* Push, overwriting the oldest element if the ring is full */ \
+	static inline void name##_push_overwrite(name##_t* r, const type* v) { \
+		uint8_t head = r->head; \
+		if (r->overwritten || (uint8_t)(head - r->tail) == (size)) { \
+			/* Published before the slot is written, and past it, so a */ \
+			/* consumer that runs in the middle never reads it half done */ \
+			r->resume = head - (size) + 1; \
+			r->overwritten = true; \
+		} \
+		RING_BARRIER(); \
+		r->buf[head & ((size) - 1)] = *v; \
+		RING_BARRIER(); \
+		r->head = head + 1; \
+	} \
+	\
+	/* Consumer: skip past anything push_overwrite has overwritten */ \
+	static inline void name##_resync(name##_t* r) { \
+		if (r->overwritten) { \
+			r->tail = r->resume; \
+			r->overwritten = false; \
+		} \
+	} \
+	\
+	/* Returns false if the ring is empty */ \
+	static inline bool name##_pop(name##_t* r, type* out) { \
+		name##_resync(r); \
+		uint8_t tail = r->tail; \
+		if (tail == r->head) { \
+			return false; \
+		} \
+		RING_BARRIER(); \
+		*out = r->buf[tail & ((size) - 1)]; \
+		RING_BARRIER(); \
+		r->tail = tail + 1; \
+		return true; \
+	} \
+	\
+	/* Producer: the free run of elements at the head that can be filled */ \
+	/* in place, up to the end of the buffer; name_commit then hands n over */ \
+	static inline uint8_t name##_write_span(name##_t* r, type** at) { \
+		uint8_t head = r->head; \
+		uint8_t index = head & ((size) - 1); \
+		uint8_t space = (size) - (uint8_t)(head - r->tail); \
+		uint8_t run = (size) - index; \
+		*at = &r->buf[index]; \
+		return space < run ? space : run; \
+	} \
+	\
+	static inline void name##_commit(name##_t* r, uint8_t n) { \
+		RING_BARRIER(); \
+		r->head += n; \
+	} \
+	\
+	/* Consumer: the run of waiting elements at the tail, up to the end of */ \
+	/* the buffer; name_release then frees n of them */ \
+	static inline uint8_t name##_read_span(name##_t* r, const type** at) { \
+		name##_resync(r); \
+		uint8_t tail = r->tail; \
+		uint8_t index = tail & ((size) - 1); \
+		uint8_t waiting = (uint8_t)(r->head - tail); \
+		uint8_t run = (size) - index; \
+		RING_BARRIER(); \
+		*at = &r->buf[index]; \
+		return waiting < run ? waiting : run; \
+	} \
+	\
+	static inline void name##_release(name##_t* r, uint8_t n) { \
+		RING_BARRIER(); \
+		r->tail += n; \
+	} \
+	\
+	/* Push as many of n elements as fit, returning how many did */ \
+	static inline uint8_t name##_push_bulk(name##_t* r, const type* src, uint8_t n) { \
+		uint8_t done = 0; \
+		while (done < n) { \
+			type* at; \
+			uint8_t run = name##_write_span(r, &at); \
+			if (run == 0) { \
+				break; \
+			} \
+			if (run > n - done) { \
+				run = n - done; \
+			} \
+			memcpy(at, src + done, run * sizeof(type)); \
+			name##_commit(r, run); \
+			done += run; \
+		} \
+		return done; \
+	} \
+	\
+	/* Pop up to n elements, returning how many there were */ \
+	static inline uint8_t name##_pop_bulk(name##_t* r, type* dst, uint8_t n) { \
+		uint8_t done = 0; \
+		while (done < n) { \
+			const type* at; \
+			uint8_t run = name##_read_span(r, &at); \
+			if (run == 0) { \
+				break; \
+			} \
+			if (run > n - done) { \
+				run = n - done; \
+			} \
+			memcpy(dst + done, at, run * sizeof(type)); \
+			name##_release(r, run); \
+			done += run; \
+		} \
+		return done; \
+	} \
+	\
+	_Static_assert((size) > 0 && (size) <= 128 && ((size) & ((size) - 1)) == 0, \
+		#name " size must be a power of two no larger than 128")
+
+#endif /* RING_H_ */
@@ -0,0 +1,75 @@
+/*
+ * Cooperative run-to-completion scheduler
+ *
+ * Work is split into tasks that are posted from ISRs or fired by the
+ * millisecond timer. The main loop always runs the highest priority pending
+ * task next, so a long log flush can never hold back input processing by
+ * more than the one task already running. With nothing pending the CPU
+ * drops into idle sleep until the next interrupt (INT2, SPI, Timer1, USB).
+ */
+
+#ifndef SCHED_H_
+#define SCHED_H_
+
+#include <stdint.h>
+
+/*!
+ * Task ids, in priority order (lowest id runs first)
+ */
+enum {
+	TASK_INPUT = 0,  // read and debounce the MCP23017 after INT2
+	TASK_GESTURE,    // close tap, hold and chord windows
+	TASK_PARAMBLOCK, // apply a parameter block uploaded over SPI
+	TASK_RANDOM,     // refill the random block taken over SPI
+	TASK_HID,        // HID gamepad reports (USE_HID_INTERFACE)
+	TASK_VENDOR,     // vendor bulk event stream (USE_VENDOR_INTERFACE)
+	TASK_USB,        // LUFA housekeeping and CDC endpoints
+	TASK_COMMAND,    // host commands received over CDC
+	TASK_LEDS,       // LED refresh
+	TASK_FEATURES,   // age and summarise the interaction features
+	TASK_GA,         // score and breed genomes, between everything else
+	TASK_LOG,        // flush the status log to the host
+	TASK_COUNT
+};
+
+typedef void (*sched_task_t)(void);
+
+typedef struct {
+	// Timer1 ticks spent asleep, and the ticks elapsed over the same period
+	uint32_t asleep;
+	uint32_t elapsed;
+	// number of times the CPU was woken from idle sleep
+	uint32_t wakeups;
+} sched_stats_t;
+
+void sched_register(uint8_t id, sched_task_t fn);
+
+/*!
+ * Mark a task as pending. Safe to call from ISRs.
+ */
+void sched_post(uint8_t id);
+
+/*!
+ * Post a task every periodMs milliseconds; 0 stops the timer.
+ */
+void sched_every(uint8_t id, uint16_t periodMs);
+
+/*!
+ * Advance the task timers by one millisecond. Called from the Timer1 ISR.
+ */
+void sched_tick(void);
+
+/*!
+ * The task running now, or TASK_COUNT between tasks
+ */
+uint8_t sched_current(void);
+
+void sched_stats(sched_stats_t* out);
+void sched_stats_reset(void);
+
+/*!
+ * Dispatch tasks forever
+ */
+void sched_run(void) __attribute__ ((noreturn));
+
+#endif /* SCHED_H_ */
@@ -0,0 +1,83 @@
+/*
+ * Arpeggiator and step sequencer
+ *
+ * Runs off a 24 PPQN clock, either generated here from a Timer1 compare B
+ * match or taken from the Pi one pulse at a time over SPI. Notes are sent
+ * from inside the clock interrupt, on MIDI out and to the synth, so they
+ * leave on the clock edge rather than when the main loop gets to them.
+ * On the internal clock every pulse is also sent as MIDI clock, with Start
+ * and Stop around them; the Pi's pulses are not passed on.
+ *
+ * Steps are sixteenth notes. The arpeggio modes walk the held inputs; the
+ * pattern mode plays a 16 step loop of input masks, which presses while
+ * it runs record into, quantised to the nearest step.
+ */
+
+#ifndef SEQ_H_
+#define SEQ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SEQ_PPQN 24
+#define SEQ_CLOCKS_PER_STEP (SEQ_PPQN / 4)
+// Clocks from a step's note on to its note off
+#define SEQ_GATE_CLOCKS (SEQ_CLOCKS_PER_STEP / 2)
+#define SEQ_STEPS 16
+
+// Timer1 ticks per minute over SEQ_PPQN, divided by the BPM for the clock period
+#define SEQ_TICKS_PER_CLOCK_BPM (60000UL * TIMER_TICKS_PER_MS / SEQ_PPQN)
+
+typedef enum {
+	SEQ_OFF,
+	SEQ_UP,
+	SEQ_DOWN,
+	SEQ_UPDOWN,
+	SEQ_RANDOM,
+	SEQ_PATTERN,
+	SEQ_MODES,
+} seq_mode_t;
+
+typedef struct {
+	uint32_t clocks;
+	// Internal clock: Timer1 ticks from the due time to the interrupt
+	// sending the clock
+	uint16_t maxLate;
+	uint32_t totalLate;
+	// Smoothed interval between clocks in Timer1 ticks, and smoothed
+	// absolute deviation from it. On the external clock these measure the
+	// Pi's timing.
+	uint32_t interval;
+	uint16_t jitter;
+	uint16_t overruns;  // MIDI out bytes dropped
+} seq_stats_t;
+
+/*!
+ * Start, stop or retime the sequencer from the arp, bpm and clock settings
+ * in config
+ */
+void seq_apply(void);
+
+bool seq_running(void);
+
+/*!
+ * Pass on a change of the debounced inputs. Called from the main loop.
+ */
+void seq_input(uint8_t state, uint8_t changed);
+
+/*!
+ * One pulse of external clock. Ignored unless the sequencer is running on
+ * the external clock. Safe to call from ISRs.
+ */
+void seq_external_clock(void);
+
+/*!
+ * Empty the step pattern
+ */
+void seq_clear(void);
+
+void seq_stats(seq_stats_t* out);
+
+void seq_stats_reset(void);
+
+#endif /* SEQ_H_ */
@@ -0,0 +1,47 @@
+/*
+ * USB start-of-frame clock
+ *
+ * The host sends a start-of-frame packet every millisecond with an 11-bit
+ * frame number. Latching each one against Timer1 lets any local timestamp
+ * be expressed in the host's USB frame time, which is the clock its audio
+ * stack is already synchronised to.
+ */
+
+#ifndef SOF_H_
+#define SOF_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+	// 11-bit USB frame number of the latest start-of-frame
+	uint16_t frame;
+	// Timer1 timestamp of that start-of-frame
+	uint32_t ticks;
+	// Timer1 ticks spanned by the last 1024 frames, 0 until first measured.
+	// Compared with 1024 * TIMER_TICKS_PER_MS this gives the crystal drift.
+	uint32_t ticksPer1024;
+} sof_latch_t;
+
+/*!
+ * Latch the current frame number. Called from EVENT_USB_Device_StartOfFrame.
+ */
+void sof_latch(void);
+
+void sof_snapshot(sof_latch_t* out);
+
+/*!
+ * Convert a Timer1 timestamp into USB frame time
+ * uint16_t* frame Frame number the timestamp falls in
+ * uint16_t* offset Timer1 ticks since the start of that frame
+ * Returns false if no start-of-frame has been seen within the last 64 ms
+ */
+bool sof_frame_time(uint32_t ticks, uint16_t* frame, uint16_t* offset);
+
+/*!
+ * Crystal drift relative to the host's frame clock in parts per million,
+ * positive when Timer1 runs fast. 0 until measured.
+ */
+int16_t sof_drift_ppm(void);
+
+#endif /* SOF_H_ */
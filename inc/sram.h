@@ -0,0 +1,41 @@
+/*
+ * SRAM budget
+ *
+ * At reset, before the C runtime sets anything up, everything from the
+ * end of the static data to the top of RAM is painted with a canary byte.
+ * The stack grows down into that paint, so the lowest overwritten byte is
+ * the deepest the stack has ever reached, nested interrupts included.
+ * That gives the real headroom between the stack and the static data and
+ * heap, rather than a guess.
+ */
+
+#ifndef SRAM_H_
+#define SRAM_H_
+
+#include <stdint.h>
+
+#define SRAM_CANARY 0xC5
+// Static data is kept small enough to leave at least this much for the
+// stack and heap; mem warns if it doesn't
+#define SRAM_STACK_MIN 400
+
+typedef struct {
+	// Static sections, in bytes
+	uint16_t data;
+	uint16_t bss;
+	uint16_t noinit;
+	uint16_t heap;       // handed out by malloc, 0 if it is never called
+	// Stack, in bytes
+	uint16_t stackNow;
+	uint16_t stackPeak;  // deepest since reset
+	uint16_t unused;     // never touched by stack or heap
+	uint16_t total;      // all of SRAM
+} sram_t;
+
+/*!
+ * Measure the sections and scan the paint for the stack high-water mark.
+ * The scan reads every free byte, so leave it to the main loop.
+ */
+void sram_report(sram_t* out);
+
+#endif /* SRAM_H_ */
@@ -0,0 +1,100 @@
+/*
+ * Wavetable synthesiser
+ *
+ * A few DDS voices reading PROGMEM wavetables, each with an ADSR envelope,
+ * mixed to one 8-bit sample. On the AVR, Timer3 runs the sample rate and
+ * Timer4, clocked at 64 MHz from the PLL, turns each sample into 250 kHz
+ * PWM on OC4A (PC7). Filter the pin with an RC low-pass before an amplifier.
+ *
+ * The engine itself has no hardware dependencies, so host/synth_render.c
+ * can build it on Linux and render it to a WAV file.
+ */
+
+#ifndef SYNTH_H_
+#define SYNTH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#if defined(__AVR__)
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define pgm_read_word(p) (*(const uint16_t*)(p))
+#define memcpy_P memcpy
+#endif
+
+#define SYNTH_RATE 16000
+#define SYNTH_VOICES 4
+// Envelopes advance once per this many samples (1 ms)
+#define SYNTH_CONTROL_SAMPLES (SYNTH_RATE / 1000)
+
+typedef enum {
+	SYNTH_WAVE_SINE,
+	SYNTH_WAVE_TRIANGLE,
+	SYNTH_WAVE_SAW,
+	SYNTH_WAVE_ORGAN,
+	SYNTH_WAVES,
+} synth_wave_t;
+
+extern const int8_t synth_wavetables[SYNTH_WAVES][256] PROGMEM;
+
+/*!
+ * Sound parameters, one byte each so a genome can carry them directly
+ */
+typedef struct {
+	uint8_t wave;     // synth_wave_t
+	uint8_t attack;   // 4 ms units, 0 for instant
+	uint8_t decay;    // 4 ms units
+	uint8_t sustain;  // level, 0-255
+	uint8_t release;  // 4 ms units
+	int8_t detune;    // added to every voice's phase increment
+	uint8_t volume;   // 0-255
+} synth_patch_t;
+
+typedef struct {
+	// cycles from the sample timer firing to the end of the ISR
+	uint16_t maxCycles;
+	uint32_t totalCycles;
+	uint32_t samples;
+} synth_stats_t;
+
+/*!
+ * Start the PLL, Timer4 PWM and the sample timer. The PLL stays on for
+ * USB as well, so call this before USB_Init.
+ */
+void synth_init(void);
+
+void synth_patch(const synth_patch_t* patch);
+
+uint8_t synth_preset_count(void);
+
+/*!
+ * Switch to one of the PROGMEM patches. Returns false if there is none.
+ */
+bool synth_preset(uint8_t preset);
+
+/*!
+ * Start or release a note
+ * uint8_t note MIDI note number
+ * uint8_t velocity 1-127, ignored on release
+ */
+void synth_note(uint8_t note, uint8_t velocity, bool on);
+
+/*!
+ * Next output sample, 128 is silence. Called at SYNTH_RATE.
+ */
+uint8_t synth_render(void);
+
+/*!
+ * Advance the envelopes by one control period
+ * Returns false once every voice has finished
+ */
+bool synth_control(void);
+
+void synth_stats(synth_stats_t* out);
+
+void synth_stats_reset(void);
+
+#endif /* SYNTH_H_ */
@@ -0,0 +1,49 @@
+/*
+ * Tap tempo
+ *
+ * Tracks the player's beat from the debounced press timestamps with a
+ * one-state Kalman filter on the beat period, in fixed point. Each
+ * inter-onset interval is folded onto the current period as half, one,
+ * two, three or four beats, whichever is closest, so playing eighths or
+ * skipping beats still counts. Intervals the filter cannot explain are
+ * outliers; after a few in a row it relocks on the new rhythm.
+ *
+ * Presses closer together than TEMPO_ONSET_MS are one onset, so chords
+ * and rolls count once. Gaps over TEMPO_GAP_MS start a new phrase.
+ */
+
+#ifndef TEMPO_H_
+#define TEMPO_H_
+
+#include <stdint.h>
+
+#define TEMPO_ONSET_MS 100
+#define TEMPO_GAP_MS 2000
+// Beat periods tracked: 240 down to 40 BPM
+#define TEMPO_MIN_MS 250
+#define TEMPO_MAX_MS 1500
+// Consecutive outliers before relocking
+#define TEMPO_RELOCK 3
+// Confidence from which the sequencer follows, with `follow` set
+#define TEMPO_FOLLOW_CONFIDENCE 160
+
+typedef struct {
+	uint16_t bpm;       // 1/16 BPM, 0 until locked
+	uint16_t periodMs;  // beat period
+	uint8_t confidence; // 0-255, falls with outliers and after TEMPO_GAP_MS without a press
+	uint8_t onsets;     // counted since the last lock, saturating
+} tempo_t;
+
+/*!
+ * Pass on a change of the debounced inputs with its Timer1 timestamp
+ */
+void tempo_input(uint8_t state, uint8_t changed, uint32_t time);
+
+/*!
+ * Current estimate. Safe to call from ISRs.
+ */
+void tempo_status(tempo_t* out);
+
+void tempo_reset(void);
+
+#endif /* TEMPO_H_ */
@@ -0,0 +1,34 @@
+/*
+ * Timer1 system tick
+ *
+ * Timer1 runs in CTC mode from F_CPU/8 and interrupts once per millisecond.
+ * The running counter gives sub-millisecond resolution for timestamps.
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdint.h>
+
+// Timer1 counts at F_CPU/8, i.e. 2 ticks per microsecond at 16 MHz
+#define TIMER_PRESCALER 8
+#define TIMER_TICKS_PER_MS ((F_CPU / 1000) / TIMER_PRESCALER)
+#define TIMER_TICKS_PER_US (TIMER_TICKS_PER_MS / 1000)
+
+extern volatile unsigned long milliseconds;
+
+void timer_init(void);
+
+/*!
+ * Milliseconds since timer_init()
+ */
+unsigned long millis(void);
+
+/*!
+ * Free-running timestamp in Timer1 ticks. Safe to call from ISRs and the
+ * main loop. Wraps after 2^32 ticks (~35 minutes at 16 MHz), so only
+ * differences between timestamps are meaningful.
+ */
+uint32_t timer_ticks(void);
+
+#endif /* TIMER_H_ */
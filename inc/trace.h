@@ -0,0 +1,83 @@
+/*
+ * Flight recorder
+ *
+ * A small ring of recent events in .noinit RAM, which the C runtime leaves
+ * alone at reset, so it outlives a watchdog reset. The watchdog runs in
+ * interrupt-then-reset mode: if the main loop stops kicking it, the
+ * interrupt records which task was running and freezes the ring, so ISRs
+ * still firing cannot push out what led up to the hang. The next timeout
+ * resets the board, and the next boot finds the ring intact and writes it
+ * to the status log. If the loop recovers in between, its next kick
+ * unfreezes the ring and re-arms the interrupt.
+ *
+ * A hang with interrupts masked never runs the watchdog interrupt, and so
+ * never resets.
+ */
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+// Entries kept, a power of two
+#define TRACE_SIZE 32
+
+enum {
+	TRACE_NONE = 0,
+	TRACE_BOOT,
+	TRACE_INT2,
+	TRACE_SPI,       // data: command byte
+	TRACE_I2C,       // data: MCP23017 register, logged as the transfer starts
+	TRACE_I2C_NAK,   // data: MCP23017 register
+	TRACE_USB,       // data: 1 connect, 0 disconnect
+	TRACE_WATCHDOG,  // data: running task, TASK_COUNT if none
+	TRACE_TYPES
+};
+
+typedef struct {
+	uint8_t type;
+	uint8_t data;
+	uint16_t ms;  // low 16 bits of millis()
+} trace_entry_t;
+
+/*!
+ * Check the ring left by the last run. Call first thing at boot, before
+ * anything is recorded and before MCUSR is cleared.
+ * Returns true if it ended with a watchdog reset
+ */
+bool trace_init(void);
+
+/*!
+ * Empty the ring and record a boot
+ */
+void trace_restart(void);
+
+/*!
+ * Record an event, unless the ring is frozen. Safe to call from ISRs.
+ */
+void trace(uint8_t type, uint8_t data);
+
+uint8_t trace_count(void);
+
+/*!
+ * Read an entry, oldest first
+ */
+void trace_get(uint8_t index, trace_entry_t* out);
+
+PGM_P trace_name(uint8_t type);
+
+/*!
+ * Start the watchdog, in interrupt-then-reset mode with a 2 s timeout.
+ * The scheduler kicks it.
+ */
+void trace_watchdog_enable(void);
+
+/*!
+ * Kick the watchdog, re-arming its interrupt if it has fired since the
+ * last kick. Called by the scheduler on every pass.
+ */
+void trace_watchdog_kick(void);
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,22 @@
+/*
+ * USB vendor-specific event stream
+ *
+ * Optional (USE_VENDOR_INTERFACE) bulk IN/OUT interface carrying the same
+ * event frames and command bytes as the SPI link, so host tools can read
+ * events at bulk rates through libusb without a tty in the way. See
+ * host/vendor_reader.c.
+ */
+
+#ifndef VENDOR_H_
+#define VENDOR_H_
+
+#include <stdbool.h>
+
+bool vendor_configure_endpoints(void);
+
+/*!
+ * Run any commands from the host and stream out pending event frames
+ */
+void vendor_task(void);
+
+#endif /* VENDOR_H_ */
@@ -282,6 +282,31 @@ int16_t CDC_Device_ReceiveByte(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInf
 	return ReceivedByte;
 }
 
+uint16_t CDC_Device_ReceiveData(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo,
+                                void* const Buffer,
+                                const uint16_t Length)
+{
+	if ((USB_DeviceState != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
+	  return 0;
+
+	Endpoint_SelectEndpoint(CDCInterfaceInfo->Config.DataOUTEndpoint.Address);
+
+	if (!(Endpoint_IsOUTReceived()))
+	  return 0;
+
+	uint8_t* DataStream  = (uint8_t*)Buffer;
+	uint16_t BytesInBank = Endpoint_BytesInEndpoint();
+	uint16_t BytesToRead = (BytesInBank < Length) ? BytesInBank : Length;
+
+	for (uint16_t i = 0; i < BytesToRead; i++)
+	  *(DataStream++) = Endpoint_Read_8();
+
+	if (BytesToRead == BytesInBank)
+	  Endpoint_ClearOUT();
+
+	return BytesToRead;
+}
+
 void CDC_Device_SendControlLineStateChange(USB_ClassInfo_CDC_Device_t* const CDCInterfaceInfo)
 {
 	if ((USB_DeviceState != DEVICE_STATE_Configured) || !(CDCInterfaceInfo->State.LineEncoding.BaudRateBPS))
@@ -68,10 +68,40 @@ uint8_t TEMPLATE_FUNC_NAME (TEMPLATE_BUFFER_TYPE const Buffer,
 		}
 		else
 		{
+			#if defined(TEMPLATE_BANK_BYTES)
+			/* Everything up to the end of the bank can be moved without re-checking the endpoint */
+			uint16_t BankBytes = TEMPLATE_BANK_BYTES();
+
+			if (BankBytes > Length)
+			  BankBytes = Length;
+
+			Length          -= BankBytes;
+			BytesInTransfer += BankBytes;
+
+			while (BankBytes >= 4)
+			{
+				TEMPLATE_TRANSFER_BYTE(DataStream);
+				TEMPLATE_BUFFER_MOVE(DataStream, 1);
+				TEMPLATE_TRANSFER_BYTE(DataStream);
+				TEMPLATE_BUFFER_MOVE(DataStream, 1);
+				TEMPLATE_TRANSFER_BYTE(DataStream);
+				TEMPLATE_BUFFER_MOVE(DataStream, 1);
+				TEMPLATE_TRANSFER_BYTE(DataStream);
+				TEMPLATE_BUFFER_MOVE(DataStream, 1);
+				BankBytes -= 4;
+			}
+
+			while (BankBytes--)
+			{
+				TEMPLATE_TRANSFER_BYTE(DataStream);
+				TEMPLATE_BUFFER_MOVE(DataStream, 1);
+			}
+			#else
 			TEMPLATE_TRANSFER_BYTE(DataStream);
 			TEMPLATE_BUFFER_MOVE(DataStream, 1);
 			Length--;
 			BytesInTransfer++;
+			#endif
 		}
 	}
 
@@ -84,6 +114,7 @@ uint8_t TEMPLATE_FUNC_NAME (TEMPLATE_BUFFER_TYPE const Buffer,
 #undef TEMPLATE_CLEAR_ENDPOINT
 #undef TEMPLATE_BUFFER_OFFSET
 #undef TEMPLATE_BUFFER_MOVE
+#undef TEMPLATE_BANK_BYTES
 
 #endif
 
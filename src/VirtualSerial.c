@@ -30,12 +30,12 @@ USB_ClassInfo_CDC_Device_t VirtualSerial_CDC_Interface = {
         .DataINEndpoint = {
             .Address = CDC_TX_EPADDR,
             .Size = CDC_TXRX_EPSIZE,
-            .Banks = 1,
+            .Banks = CDC_TXRX_BANKS,
         },
         .DataOUTEndpoint = {
             .Address = CDC_RX_EPADDR,
             .Size = CDC_TXRX_EPSIZE,
-            .Banks = 1,
+            .Banks = CDC_TXRX_BANKS,
         },
         .NotificationEndpoint = {
             .Address = CDC_NOTIFICATION_EPADDR,
@@ -46,38 +46,241 @@ USB_ClassInfo_CDC_Device_t VirtualSerial_CDC_Interface = {
 };
 
 static FILE USBSerialStream;
-static char statusBuffer[1024] = "";
 static bool hostReady = false;
 volatile uint8_t buttons = 0;  // data buffer for sending to SPI
 
-volatile unsigned long milliseconds = 0;
+// Timestamp of the last INT2 edge, picked up by inputTask
+static volatile uint32_t inputEdge;
+static volatile bool inputEdgePending = false;
+static unsigned long lastInput = 0;
+// Debounced level of the inputs, one bit per held button
+static uint8_t inputState = 0;
+
+// SPI multi-byte responses are clocked out one byte per host transfer
+static uint8_t spiResponse[PROTOCOL_MAX_RESPONSE];
+static const uint8_t* spiBurst;
+static uint8_t spiBurstLen = 0;
+// The response being clocked out reports a press; its latency is binned once the last byte has gone
+static bool spiPressPending = false;
+
+// Status messages waiting for the host, as pointers to the strings rather than copies
+typedef struct {
+    const char* text;
+    bool flash;
+} log_entry_t;
+static log_entry_t statusLog[LOG_ENTRIES];
+static uint8_t statusCount = 0;
+
+// The previous run's flight recorder after a watchdog reset, until logTask has written it out
+static trace_entry_t lastRun[TRACE_SIZE];
+static uint8_t lastRunCount = 0;
+
+static void logEntry(const char* text, bool flash) {
+    if (statusCount < LOG_ENTRIES) {
+        statusLog[statusCount].text = text;
+        statusLog[statusCount].flash = flash;
+        statusCount++;
+    }
+    sched_post(TASK_LOG);
+}
 
-uint8_t ret;
+/** Queues a message for the host. It is written out by logTask once the host has opened the port,
+ *  so it must stay put until then, like a string literal. Must be called from the main loop, not from an ISR.
+ */
+void logStatus(const char* msg) {
+    logEntry(msg, false);
+}
 
-void logStatus(char* msg) {
-    if (hostReady) {
-        fputs(msg, &USBSerialStream);
+/** Queues a message held in flash, as logStatus does. */
+static void logStatus_P(PGM_P msg) {
+    logEntry(msg, true);
+}
+
+/** Updates the debounced input level, queueing an event for each input that changed
+ *  and passing the new level on to the HID interface.
+ */
+static void setInputState(uint8_t state, uint32_t time) {
+    uint8_t changed = state ^ inputState;
+    if (changed) {
+        for (uint8_t i = 0; i < 8; i++) {
+            if (changed & (1 << i)) {
+                event_post((state & (1 << i)) ? EVENT_PRESS : EVENT_RELEASE, i, time);
+                if (state & (1 << i)) {
+                    COUNTERS_INC(presses[i]);
+                }
+#if defined(USE_SYNTH)
+                // While the sequencer runs, the inputs feed it instead
+                if (!seq_running()) {
+                    midi_t note;
+                    Midi(i, state & (1 << i), &note);
+                    synth_note(note.note_number, note.velocity, state & (1 << i));
+                }
+#endif
+            }
+        }
+        inputState = state;
+        feature_input(state, changed, time);
+        gesture_input(state, changed, time);
+        seq_input(state, changed);
+        tempo_input(state, changed, time);
+#if defined(USE_HID_INTERFACE)
+        hid_set_state(state);
+        sched_post(TASK_HID);
+#endif
+#if defined(USE_VENDOR_INTERFACE)
+        sched_post(TASK_VENDOR);
+#endif
+    }
+}
+
+/** Reads the captured MCP23017 inputs after an INT2 edge, or re-reads the
+ *  inputs once the debounce window has passed after an ignored edge.
+ */
+static void inputTask(void) {
+    uint32_t edge;
+    bool edgePending;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+        edge = inputEdge;
+        edgePending = inputEdgePending;
+        inputEdgePending = false;
+    }
+    unsigned long now = millis();
+
+    if (!edgePending) {
+        // Resync timer: pick up the settled level the ignored edge left behind
+        if ((now - lastInput) > config.debounceMs) {
+            sched_every(TASK_INPUT, 0);
+            setInputState(mcp23017_read_reg(GPIOA), timer_ticks());
+        }
+        return;
+    }
+
+    // Reading INTCAPA also releases the MCP23017 INT line, so it is read even inside the debounce window
+    uint8_t pressed = mcp23017_read_reg(INTCAPA);
+    if ((now - lastInput) > config.debounceMs) {
+        lastInput = now;
+        setInputState(pressed, edge);
+        if (pressed) {
+            LEDs_TurnOnLEDs(LED_INPUT);
+            ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+                buttons |= pressed;
+            }
+            latency_capture(edge);
+        }
+    } else {
+        // A period of 0 would cancel the resync, which needs at least a millisecond to pass
+        sched_every(TASK_INPUT, config.debounceMs ? config.debounceMs : 1);
+    }
+}
+
+/** Services LUFA and the CDC endpoints. */
+static void usbTask(void) {
+    /* Host bytes must be drained from the endpoint, or it will lock up while waiting for the device */
+    if (command_receive(&VirtualSerial_CDC_Interface)) {
+        sched_post(TASK_COMMAND);
+    }
+    CDC_Device_USBTask(&VirtualSerial_CDC_Interface);
+    USB_USBTask();
+}
+
+/** Runs complete command lines received from the host. */
+static void commandTask(void) {
+    command_process(&USBSerialStream);
+}
+
+/** Turns the input indicator back off after a press. */
+static void ledTask(void) {
+    if ((millis() - lastInput) > LED_INPUT_MS) {
+        LEDs_TurnOffLEDs(LED_INPUT);
+    }
+}
+
+/** Keeps the flight recorder ring left by the previous run, which ended with a watchdog reset,
+ *  for logTask. It is kept as entries rather than text, which would take four times the RAM.
+ */
+static void saveTrace(void) {
+    lastRunCount = trace_count();
+    for (uint8_t i = 0; i < lastRunCount; i++) {
+        trace_get(i, &lastRun[i]);
+    }
+}
+
+/** Writes out the saved flight recorder ring. Times are in ms before the reset. */
+static void writeTrace(void) {
+    const trace_entry_t* last = &lastRun[lastRunCount - 1];
+    if (last->type == TRACE_WATCHDOG) {
+        fprintf_P(&USBSerialStream, PSTR("Watchdog reset in task %u, last %u events:\n\r"), last->data, lastRunCount);
     } else {
-        strcat(statusBuffer, msg);
+        fprintf_P(&USBSerialStream, PSTR("Watchdog reset, last %u events:\n\r"), lastRunCount);
+    }
+    for (uint8_t i = 0; i < lastRunCount; i++) {
+        const trace_entry_t* e = &lastRun[i];
+        fprintf_P(&USBSerialStream, PSTR("%6d %S %02x\n\r"), (int16_t)(e->ms - last->ms), trace_name(e->type), e->data);
     }
 }
 
+/** Writes out the saved flight recorder ring, then the queued status messages, once the host is listening. */
+static void logTask(void) {
+    if (!hostReady) {
+        return;
+    }
+    if (lastRunCount) {
+        writeTrace();
+        lastRunCount = 0;
+    }
+    for (uint8_t i = 0; i < statusCount; i++) {
+        if (statusLog[i].flash) {
+            fputs_P(statusLog[i].text, &USBSerialStream);
+        } else {
+            fputs(statusLog[i].text, &USBSerialStream);
+        }
+    }
+    statusCount = 0;
+}
 
 int main(void) {
     char* errMsg = "";
-    uint8_t bufLen = 80;
-    char buf[bufLen];
+
+    // Before anything can record over the previous run's trace
+    bool watchdogReset = trace_init();
 
     SetupHardware();
     LEDs_TurnOnLEDs(LED_POWER);
-    logStatus("Serial comms initialized\n\r");
-
-    // Set up timer
-    unsigned long CTC_MATCH_OVERFLOW = (F_CPU / 1000) / 8;
-    TCCR1B |= (1 << WGM12) | (1 << CS11);
-    OCR1AH = (CTC_MATCH_OVERFLOW >> 8);
-    OCR1AL = CTC_MATCH_OVERFLOW;
-    TIMSK1 |= (1 << OCIE1A);  // Enable iinterrupt on clock compare
+    logStatus_P(PSTR("Serial comms initialized\n\r"));
+    if (watchdogReset) {
+        saveTrace();
+    }
+    trace_restart();
+
+    // Set up timer and scheduler
+    timer_init();
+    prng_init();
+    prng_refill();
+    midi_out_init();
+    sched_register(TASK_INPUT, inputTask);
+    sched_register(TASK_GESTURE, gesture_task);
+    sched_register(TASK_PARAMBLOCK, paramblock_task);
+    sched_register(TASK_RANDOM, prng_refill);
+#if defined(USE_HID_INTERFACE)
+    sched_register(TASK_HID, hid_task);
+#endif
+#if defined(USE_VENDOR_INTERFACE)
+    sched_register(TASK_VENDOR, vendor_task);
+#endif
+    sched_register(TASK_USB, usbTask);
+    sched_register(TASK_COMMAND, commandTask);
+    sched_register(TASK_LEDS, ledTask);
+    sched_register(TASK_FEATURES, feature_task);
+    sched_register(TASK_GA, ga_task);
+    sched_register(TASK_LOG, logTask);
+    sched_every(TASK_USB, 1);
+    sched_every(TASK_LEDS, LED_INPUT_MS);
+    sched_every(TASK_FEATURES, FEATURE_REFRESH_MS);
+    sched_every(TASK_LOG, LOG_FLUSH_MS);
+    if (config_load()) {
+        logStatus_P(PSTR("Loaded saved settings\n\r"));
+    }
+    config_apply();
 
     /* Create a regular character stream for the interface so that it can be used with the stdio.h functions */
     CDC_Device_CreateStream(&VirtualSerial_CDC_Interface, &USBSerialStream);
@@ -85,25 +288,26 @@ int main(void) {
     GlobalInterruptEnable();
 
     // Set up INT2 (PD2) up as external interrupt
-    logStatus("Initializing external interrupt\n\r");
+    logStatus_P(PSTR("Initializing external interrupt\n\r"));
     DDRD |= (1 << PIND2);
     PORTD |= (1 << PIND2);
     EIMSK |= (1 << INT2);
     EIFR |= (1 << INTF2);
     EICRA |= (1 << ISC21) | (1 << ISC20);
-    logStatus("External interrupt initialized\n\r");
+    logStatus_P(PSTR("External interrupt initialized\n\r"));
 
-    logStatus("Initializing I2C\n\r");
+    logStatus_P(PSTR("Initializing I2C\n\r"));
     i2c_init();
-    logStatus("I2C initialized\n\r");
+    logStatus_P(PSTR("I2C initialized\n\r"));
 
-    logStatus("Initializing MCP23017\n\r");
+    logStatus_P(PSTR("Initializing MCP23017\n\r"));
     uint8_t mcpResult = mcp23017_init(&errMsg);
     if (mcpResult == 0) {
-        logStatus("MCP23017 initialized successfully\n\r");
+        logStatus_P(PSTR("MCP23017 initialized successfully\n\r"));
     } else {
-        snprintf(buf, bufLen, "Failed to initialize MCP23107: %s\n\r", errMsg);
-        logStatus(buf);
+        logStatus_P(PSTR("Failed to initialize MCP23107: "));
+        logStatus(errMsg);
+        logStatus_P(PSTR("\n\r"));
     }
 
     // Initialize SPI as slave device
@@ -132,53 +336,64 @@ int main(void) {
 
     // Enable SPI by writing 0 to PRSPI bit (2) in PRR0 register
     // The SPI Master initiates the communication cycle when pulling low the Slave Select SS pin of the desired Slave
-    logStatus("Initializing SPI slave\n\r");
+    logStatus_P(PSTR("Initializing SPI slave\n\r"));
     DDR_SPI |= (1<<DD_MISO);
     DDR_SPI &= ~(1<<DD_MOSI);
     DDR_SPI &= ~(1<<DD_SCK);
     DDR_SPI &= ~(1<<DD_SS);
     // Enable SPI, enable interrupt
     SPCR = (1<<SPE) | (1<<SPIE);
-    logStatus("SPI slave initialized\n\r");
-
-    while (1) {
-        /* Must throw away unused bytes from the host, or it will lock up while waiting for the device */
-        CDC_Device_ReceiveByte(&VirtualSerial_CDC_Interface);
-        CDC_Device_USBTask(&VirtualSerial_CDC_Interface);
-        USB_USBTask();
-    }
-}
+    logStatus_P(PSTR("SPI slave initialized\n\r"));
 
-ISR (TIMER1_COMPA_vect) {
-    ++milliseconds;
+    trace_watchdog_enable();
+    sched_run();
 }
 
-unsigned long millisElapsed = 0;
 ISR (INT2_vect) {
-    // check debounce
-    if ((milliseconds - millisElapsed) > 50) {
-        millisElapsed += milliseconds;
-        LEDs_TurnOnLEDs(LED_INPUT);
-
-        ret = mcp23017_read_reg(INTCAPA);
-        for (uint8_t i = 0; i < sizeof(ret) * 8; i++) {
-            if (ret & 1 << i) {
-                buttons |= (1 << i);
-            }
-        }
-
-        LEDs_TurnOffLEDs(LED_INPUT);
-        EIFR |= (1 << INTF2);
-    }
-    // re-enable interrupt
+    // The I2C read is slow, so leave it to inputTask
+    inputEdge = timer_ticks();
+    inputEdgePending = true;
+    prng_stir((uint8_t)inputEdge);
+    trace(TRACE_INT2, 0);
+    sched_post(TASK_INPUT);
 }
 
 ISR (SPI_STC_vect) {
     uint8_t command;
     command = SPDR;
-    if (command == 0x80) {
-        SPDR = buttons;
-        buttons = 0;
+    // Latch the sync time first thing, as close to the end of the byte as the ISR gets
+    uint32_t syncTicks = 0;
+    if (command == CMD_SYNC) {
+        syncTicks = timer_ticks();
+    }
+    if (spiPressPending && spiBurstLen == 0) {
+        // this transfer shifted out the last byte of the response
+        spiPressPending = false;
+        latency_sent();
+    }
+    if (paramblock_receiving()) {
+        // every byte is data until the block is complete
+        SPDR = paramblock_receive(command);
+        spiBurstLen = 0;
+    } else if (command & CMD_MASK) {
+        COUNTERS_INC(spiCommands);
+        trace(TRACE_SPI, command);
+        uint8_t len = command == CMD_SYNC ? protocol_sync(syncTicks, spiResponse)
+                                          : protocol_command(command, EVENT_READER_SPI, spiResponse);
+        // A command cuts short any response still going out
+        spiPressPending = len && protocol_carries_press(command, spiResponse);
+        if (len) {
+            spiBurst = spiResponse;
+            SPDR = *spiBurst++;
+            spiBurstLen = len - 1;
+        } else {
+            spiBurstLen = 0;
+            SPDR = 0;
+        }
+    } else if (spiBurstLen > 0) {
+        // filler byte from the host: shift out the next response byte
+        SPDR = *spiBurst++;
+        spiBurstLen--;
     } else {
         SPDR = 0;
     }
@@ -195,28 +410,50 @@ void SetupHardware(void) {
 
     /* Hardware Initialization */
     LEDs_Init();
+#if defined(USE_SYNTH)
+    synth_init();
+    synth_preset(0);
+#endif
     USB_Init();
 }
 
 /** Event handler for the library USB Connection event. */
 void EVENT_USB_Device_Connect(void) {
+    COUNTERS_INC(usbConnects);
+    trace(TRACE_USB, 1);
     LEDs_SetAllLEDs(LEDMASK_USB_ENUMERATING);
 }
 
 /** Event handler for the library USB Disconnection event. */
 void EVENT_USB_Device_Disconnect(void) {
+    trace(TRACE_USB, 0);
     LEDs_SetAllLEDs(LEDMASK_USB_NOTREADY);
 }
 
 /** Event handler for the library USB Configuration Changed event. */
 void EVENT_USB_Device_ConfigurationChanged(void) {
     bool ConfigSuccess = CDC_Device_ConfigureEndpoints(&VirtualSerial_CDC_Interface);
+#if defined(USE_HID_INTERFACE)
+    ConfigSuccess &= hid_configure_endpoints();
+#endif
+#if defined(USE_VENDOR_INTERFACE)
+    ConfigSuccess &= vendor_configure_endpoints();
+#endif
+    USB_Device_EnableSOFEvents();
     LEDs_SetAllLEDs(ConfigSuccess ? LEDMASK_USB_READY : LEDMASK_USB_ERROR);
 }
 
+/** Event handler for the library USB Start of Frame event, latching the host's frame clock. */
+void EVENT_USB_Device_StartOfFrame(void) {
+    sof_latch();
+}
+
 /** Event handler for the library USB Control Request reception event. */
 void EVENT_USB_Device_ControlRequest(void) {
     CDC_Device_ProcessControlRequest(&VirtualSerial_CDC_Interface);
+#if defined(USE_HID_INTERFACE)
+    hid_process_control_request();
+#endif
 }
 
 /** CDC class driver callback function the processing of changes to the virtual
@@ -226,8 +463,7 @@ void EVENT_USB_Device_ControlRequest(void) {
  */
 void EVENT_CDC_Device_ControLineStateChanged(USB_ClassInfo_CDC_Device_t *const CDCInterfaceInfo) {
     hostReady = (CDCInterfaceInfo->State.ControlLineStates.HostToDevice & CDC_CONTROL_LINE_OUT_DTR) != 0;
-    if (hostReady && strlen(statusBuffer) > 0) {
-        fputs(statusBuffer, &USBSerialStream);
-        strcpy(statusBuffer, "");
+    if (hostReady) {
+        sched_post(TASK_LOG);
     }
 }
@@ -0,0 +1,652 @@
+/*
+ * CDC command interpreter
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+#include "command.h"
+#include "config.h"
+#include "counters.h"
+#include "LUFA/Descriptors.h"
+#include "event.h"
+#include "feature.h"
+#include "ga.h"
+#include "latency.h"
+#include "midi.h"
+#include "prng.h"
+#include "ring.h"
+#include "sched.h"
+#include "seq.h"
+#include "sof.h"
+#include "sram.h"
+#include "synth.h"
+#include "tempo.h"
+#include "timer.h"
+#include "trace.h"
+
+// Written by command_receive, read by command_process
+RING_DEFINE(rx_ring, uint8_t, COMMAND_RX_SIZE);
+static rx_ring_t rx;
+
+// Rings for the ring command's cycle counts. They live on its stack, one
+// at a time, rather than taking RAM for good.
+#define RING_BENCH_N 16
+RING_DEFINE(bench_byte_ring, uint8_t, RING_BENCH_N);
+RING_DEFINE(bench_event_ring, event_t, RING_BENCH_N);
+
+// CDC interface the commands arrived on, for commands that write to it directly
+static USB_ClassInfo_CDC_Device_t* port;
+
+static char line[COMMAND_LINE_MAX];
+static uint8_t lineLen = 0;
+static uint8_t lineOverflow = 0;
+
+typedef void (*command_fn_t)(char* args, FILE* out);
+
+typedef struct {
+	char name[12];
+	command_fn_t run;
+} command_t;
+
+static void cmd_help(char* args, FILE* out);
+
+static void cmd_latency(char* args, FILE* out) {
+	if (strcmp_P(args, PSTR("reset")) == 0) {
+		latency_reset();
+		return;
+	}
+	latency_histogram_t h;
+	latency_snapshot(&h);
+	for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+		if (h.bucket[i]) {
+			fprintf_P(out, PSTR("%lu-%lu us: %u\r\n"),
+				(1UL << i) / TIMER_TICKS_PER_US, (2UL << i) / TIMER_TICKS_PER_US, h.bucket[i]);
+		}
+	}
+	fprintf_P(out, PSTR("max %lu us\r\n"), h.max / TIMER_TICKS_PER_US);
+}
+
+static void cmd_sleep(char* args, FILE* out) {
+	(void)args;
+	sched_stats_t st;
+	sched_stats(&st);
+	// percentage without overflowing 32 bits
+	unsigned long pct = st.elapsed ? st.asleep / (st.elapsed / 100 + 1) : 0;
+	fprintf_P(out, PSTR("asleep %lu%%, %lu wakeups\r\n"), pct, st.wakeups);
+}
+
+// Gap in the host's data after which bench read gives up
+#define BENCH_READ_IDLE_MS 2000
+
+static void print_bench(uint32_t bytes, uint32_t ticks, uint32_t copyTicks, FILE* out) {
+	uint32_t ms = ticks / TIMER_TICKS_PER_MS;
+	// tenths of a CPU cycle per byte
+	uint32_t cycles = bytes ? copyTicks * TIMER_PRESCALER * 10 / bytes : 0;
+	fprintf_P(out, PSTR("%lu bytes in %lu ms, %lu bytes/s, copy %lu.%lu cycles/byte\r\n"),
+		bytes, ms, bytes * 1000UL / (ms ? ms : 1), cycles / 10, cycles % 10);
+}
+
+/*
+ * Device to host: the endpoint stream, not stdio, is what is measured.
+ * Given BytesProcessed, the stream returns at each full bank rather than
+ * waiting on the host, so the timed part is just the copy into the bank.
+ */
+static void bench_write(uint32_t total, uint32_t overhead, FILE* out) {
+	uint8_t block[CDC_TXRX_EPSIZE];
+	for (uint8_t i = 0; i < sizeof(block); i++) {
+		block[i] = 'a' + i % 26;
+	}
+
+	uint32_t sent = 0;
+	uint32_t copyTicks = 0;
+	uint32_t start = timer_ticks();
+	Endpoint_SelectEndpoint(port->Config.DataINEndpoint.Address);
+	while (sent < total) {
+		uint16_t n = (total - sent < sizeof(block)) ? total - sent : sizeof(block);
+		uint16_t done = 0;
+		uint8_t err;
+		do {
+			if (Endpoint_WaitUntilReady() != ENDPOINT_READYWAIT_NoError) {
+				err = ENDPOINT_RWSTREAM_Timeout;
+				break;
+			}
+			uint32_t t = timer_ticks();
+			err = Endpoint_Write_Stream_LE(block, n, &done);
+			copyTicks += timer_ticks() - t - overhead;
+		} while (err == ENDPOINT_RWSTREAM_IncompleteTransfer);
+		if (err != ENDPOINT_RWSTREAM_NoError) {
+			break;
+		}
+		sent += n;
+		// a long run can outlast the watchdog
+		wdt_reset();
+	}
+	CDC_Device_Flush(port);
+	uint32_t ticks = timer_ticks() - start;
+	fputs_P(PSTR("\r\nsent "), out);
+	print_bench(sent, ticks, copyTicks, out);
+}
+
+/*
+ * Host to device: reads what the host sends after the command straight off
+ * the OUT endpoint, timing only the copy out of each bank, which holds
+ * whole packets. Stops at total bytes or after BENCH_READ_IDLE_MS without
+ * any.
+ */
+static void bench_read(uint32_t total, uint32_t overhead, FILE* out) {
+	uint8_t block[CDC_TXRX_EPSIZE];
+	uint32_t received = 0;
+	uint32_t copyTicks = 0;
+	uint32_t start = 0;
+	unsigned long idle = millis();
+	Endpoint_SelectEndpoint(port->Config.DataOUTEndpoint.Address);
+	while (received < total && millis() - idle < BENCH_READ_IDLE_MS) {
+		wdt_reset();
+		if (!Endpoint_IsOUTReceived()) {
+			continue;
+		}
+		if (!received) {
+			// the clock starts with the first packet, not with the command
+			start = timer_ticks();
+		}
+		uint16_t n = Endpoint_BytesInEndpoint();
+		if (n > sizeof(block)) {
+			n = sizeof(block);
+		}
+		if (n > total - received) {
+			n = total - received;
+		}
+		uint32_t t = timer_ticks();
+		Endpoint_Read_Stream_LE(block, n, NULL);
+		copyTicks += timer_ticks() - t - overhead;
+		received += n;
+		if (!Endpoint_BytesInEndpoint()) {
+			Endpoint_ClearOUT();
+		}
+		idle = millis();
+	}
+	uint32_t ticks = received ? timer_ticks() - start : 0;
+	fputs_P(PSTR("received "), out);
+	print_bench(received, ticks, copyTicks, out);
+}
+
+static void cmd_bench(char* args, FILE* out) {
+	bool read = strncmp_P(args, PSTR("read"), 4) == 0;
+	if (read) {
+		args += 4;
+	}
+	uint32_t total = *args ? strtoul(args, NULL, 0) : 65536;
+	if (total > 1000000) {
+		total = 1000000;
+	}
+
+	if (USB_DeviceState != DEVICE_STATE_Configured) {
+		return;
+	}
+
+	// Calibrate out the cost of taking the timestamps themselves
+	uint32_t overhead = timer_ticks();
+	overhead = timer_ticks() - overhead;
+
+	if (read) {
+		bench_read(total, overhead, out);
+	} else {
+		bench_write(total, overhead, out);
+	}
+}
+
+static void cmd_sof(char* args, FILE* out) {
+	(void)args;
+	uint16_t frame;
+	uint16_t offset;
+	if (!sof_frame_time(timer_ticks(), &frame, &offset)) {
+		fputs_P(PSTR("no start-of-frame\r\n"), out);
+		return;
+	}
+	fprintf_P(out, PSTR("frame %u +%u us, drift %d ppm\r\n"),
+		frame, (unsigned)(offset / TIMER_TICKS_PER_US), sof_drift_ppm());
+}
+
+static void cmd_counters(char* args, FILE* out) {
+	if (strcmp_P(args, PSTR("reset")) == 0) {
+		counters_reset();
+		return;
+	}
+	counters_t c;
+	counters_snapshot(&c);
+	fprintf_P(out, PSTR("over %lu s:\r\npresses"), c.ms / 1000);
+	for (uint8_t i = 0; i < COUNTERS_INPUTS; i++) {
+		fprintf_P(out, PSTR(" %u"), c.presses[i]);
+	}
+	fprintf_P(out, PSTR("\r\n%lu events, %lu SPI commands, %u I2C errors, %u USB connects\r\n"),
+		c.events, c.spiCommands, c.i2cErrors, c.usbConnects);
+	fprintf_P(out, PSTR("high water: events %u/%u SPI %u/%u USB, commands %u/%u, MIDI %u/%u\r\n"),
+		c.eventHigh[EVENT_READER_SPI], EVENT_QUEUE_SIZE, c.eventHigh[EVENT_READER_USB], EVENT_QUEUE_SIZE,
+		c.commandHigh, COMMAND_RX_SIZE, c.midiHigh, MIDI_TX_SIZE);
+}
+
+static void cmd_features(char* args, FILE* out) {
+	if (strcmp_P(args, PSTR("reset")) == 0) {
+		feature_reset();
+		return;
+	}
+	feature_t f;
+	feature_snapshot(&f);
+	fprintf_P(out, PSTR("all: %u presses, ioi %u+-%u ms\r\n"), f.presses, f.ioiMean, f.ioiSd);
+	for (uint8_t i = 0; i < FEATURE_INPUTS; i++) {
+		feature_input_t* in = &f.input[i];
+		fprintf_P(out, PSTR("%u: %u presses, ioi %u+-%u ms, hold %u ms\r\n"), i, in->presses,
+			in->ioiMean * FEATURE_UNIT_MS, in->ioiSd * FEATURE_UNIT_MS, in->hold * FEATURE_UNIT_MS);
+	}
+	uint8_t p = 0;
+	for (uint8_t i = 0; i < FEATURE_INPUTS; i++) {
+		for (uint8_t j = i + 1; j < FEATURE_INPUTS; j++, p++) {
+			uint8_t count = (f.chords[p / 2] >> ((p & 1) * 4)) & 0x0F;
+			if (count) {
+				fprintf_P(out, PSTR("chord %u+%u: %u\r\n"), i, j, count);
+			}
+		}
+	}
+}
+
+static void print_param(uint8_t index, FILE* out) {
+	fprintf_P(out, PSTR("%S %d\r\n"), config_name(index), config_get(index));
+}
+
+static void cmd_ga(char* args, FILE* out) {
+	(void)args;
+	ga_status_t st;
+	ga_status(&st);
+	fprintf_P(out, PSTR("generation %u, playing %u: %08lx, best %08lx scored %u\r\n"),
+		st.generation, st.current, st.genome, st.best, st.bestFitness);
+}
+
+static void cmd_get(char* args, FILE* out) {
+	if (*args == '\0') {
+		for (uint8_t i = 0; i < config_count(); i++) {
+			print_param(i, out);
+		}
+		return;
+	}
+	uint8_t index = config_find(args);
+	if (index == config_count()) {
+		fprintf_P(out, PSTR("unknown parameter: %s\r\n"), args);
+		return;
+	}
+	print_param(index, out);
+}
+
+static void cmd_mem(char* args, FILE* out) {
+	(void)args;
+	sram_t m;
+	sram_report(&m);
+	fprintf_P(out, PSTR("data %u, bss %u, noinit %u, heap %u bytes\r\n"), m.data, m.bss, m.noinit, m.heap);
+	fprintf_P(out, PSTR("stack %u now, %u peak; %u of %u bytes never used\r\n"),
+		m.stackNow, m.stackPeak, m.unused, m.total);
+	uint16_t free = m.total - m.data - m.bss - m.noinit;
+	if (free < SRAM_STACK_MIN) {
+		fprintf_P(out, PSTR("static data leaves only %u bytes for the stack\r\n"), free);
+	}
+}
+
+static void print_map_field(uint8_t value, uint8_t override, FILE* out) {
+	fprintf_P(out, PSTR(" %3u%c"), value, override == MIDI_DEFAULT ? ' ' : '*');
+}
+
+/*
+ * map                               list what each input plays, * marking overrides
+ * map <input> <field> <value|->     override note, channel or velocity, - to follow the setting
+ * map <input> -                     drop all of an input's overrides
+ */
+static void cmd_map(char* args, FILE* out) {
+	if (*args == '\0') {
+		fputs_P(PSTR("input note chan vel\r\n"), out);
+		for (uint8_t i = 0; i < MIDI_INPUTS; i++) {
+			midi_input_t m;
+			midi_mapped(i, &m);
+			const midi_input_t* o = &config.inputs[i];
+			fprintf_P(out, PSTR("%5u"), i);
+			print_map_field(m.note, o->note, out);
+			print_map_field(m.channel, o->channel, out);
+			print_map_field(m.velocity, o->velocity, out);
+			fputs_P(PSTR("\r\n"), out);
+		}
+		return;
+	}
+
+	char* end;
+	uint8_t input = strtoul(args, &end, 0);
+	while (*end == ' ') {
+		end++;
+	}
+	midi_input_t m = config.inputs[input < MIDI_INPUTS ? input : 0];
+	char* value = strchr(end, ' ');
+	if (value) {
+		*value++ = '\0';
+	}
+	uint8_t v = MIDI_DEFAULT;
+	if (value && *value != '-') {
+		long l = strtol(value, NULL, 0);
+		// anything out of range fails midi_map's checks
+		v = (l < 0 || l > 127) ? 128 : l;
+	}
+	bool ok = true;
+	if (strcmp_P(end, PSTR("-")) == 0) {
+		m.note = m.channel = m.velocity = MIDI_DEFAULT;
+	} else if (!value) {
+		ok = false;
+	} else if (strcmp_P(end, PSTR("note")) == 0) {
+		m.note = v;
+	} else if (strcmp_P(end, PSTR("channel")) == 0) {
+		m.channel = v;
+	} else if (strcmp_P(end, PSTR("velocity")) == 0) {
+		m.velocity = v;
+	} else {
+		ok = false;
+	}
+	if (!ok || !midi_map(input, &m)) {
+		fputs_P(PSTR("usage: map <input 0-7> <note 0-127|channel 0-15|velocity 1-127> <value|->, or map <input> -\r\n"), out);
+	}
+}
+
+static void cmd_preset(char* args, FILE* out) {
+	if (*args == '\0') {
+		for (uint8_t i = 0; i < midi_preset_count(); i++) {
+			fprintf_P(out, PSTR("%u %S\r\n"), i, midi_preset_name(i));
+		}
+		return;
+	}
+	uint8_t preset;
+	for (preset = 0; preset < midi_preset_count(); preset++) {
+		if (strcmp_P(args, midi_preset_name(preset)) == 0) {
+			break;
+		}
+	}
+	if (preset == midi_preset_count() && *args >= '0' && *args <= '9') {
+		preset = atoi(args);
+	}
+	if (!midi_preset(preset)) {
+		fprintf_P(out, PSTR("unknown preset: %s\r\n"), args);
+	}
+}
+
+static void cmd_random(char* args, FILE* out) {
+	uint8_t len = atoi(args);
+	if (len == 0 || len > 64) {
+		len = 16;
+	}
+	uint8_t buf[64];
+	prng_fill(buf, len);
+	for (uint8_t i = 0; i < len; i++) {
+		fprintf_P(out, PSTR("%02x"), buf[i]);
+	}
+	prng_stats_t st;
+	prng_stats(&st);
+	fprintf_P(out, PSTR("\r\n%lu samples stirred, %u reseeds\r\n"), st.samples, st.reseeds);
+}
+
+// Tenths of a CPU cycle per operation, from Timer1 ticks over RING_BENCH_N operations
+static uint32_t bench_cycles(uint32_t ticks, uint32_t overhead) {
+	return (ticks - overhead) * TIMER_PRESCALER * 10 / RING_BENCH_N;
+}
+
+static void print_cycles(PGM_P label, uint32_t tenths, FILE* out) {
+	fprintf_P(out, PSTR("%S %lu.%lu"), label, tenths / 10, tenths % 10);
+}
+
+static void cmd_ring(char* args, FILE* out) {
+	(void)args;
+	union {
+		bench_byte_ring_t bytes;
+		bench_event_ring_t events;
+	} r;
+	uint8_t block[RING_BENCH_N];
+	event_t e = { 0 };
+	volatile uint8_t sink = 0;
+	uint32_t t[8];
+
+	for (uint8_t i = 0; i < RING_BENCH_N; i++) {
+		block[i] = i;
+	}
+	// Interrupts off, so only the ring operations are timed. Each batch is
+	// well under the 1 ms timer_ticks can cover without them.
+	r.bytes = (bench_byte_ring_t){ 0 };
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		t[0] = timer_ticks();
+		t[1] = timer_ticks();
+		for (uint8_t i = 0; i < RING_BENCH_N; i++) {
+			bench_byte_ring_push(&r.bytes, &block[i]);
+		}
+		t[2] = timer_ticks();
+		for (uint8_t i = 0; i < RING_BENCH_N; i++) {
+			uint8_t b;
+			bench_byte_ring_pop(&r.bytes, &b);
+			sink += b;
+		}
+		t[3] = timer_ticks();
+		bench_byte_ring_push_bulk(&r.bytes, block, RING_BENCH_N);
+		bench_byte_ring_pop_bulk(&r.bytes, block, RING_BENCH_N);
+		t[4] = timer_ticks();
+		r.events = (bench_event_ring_t){ 0 };
+		t[5] = timer_ticks();
+		for (uint8_t i = 0; i < RING_BENCH_N; i++) {
+			e.data = i;
+			bench_event_ring_push(&r.events, &e);
+		}
+		t[6] = timer_ticks();
+		for (uint8_t i = 0; i < RING_BENCH_N; i++) {
+			bench_event_ring_pop(&r.events, &e);
+			sink += e.data;
+		}
+		t[7] = timer_ticks();
+	}
+	uint32_t overhead = t[1] - t[0];
+	print_cycles(PSTR("cycles: byte push"), bench_cycles(t[2] - t[1], overhead), out);
+	print_cycles(PSTR(", pop"), bench_cycles(t[3] - t[2], overhead), out);
+	print_cycles(PSTR(", bulk push+pop"), bench_cycles(t[4] - t[3], overhead), out);
+	print_cycles(PSTR(" per byte; event push"), bench_cycles(t[6] - t[5], overhead), out);
+	print_cycles(PSTR(", pop"), bench_cycles(t[7] - t[6], overhead), out);
+	fputs_P(PSTR("\r\n"), out);
+}
+
+static void cmd_save(char* args, FILE* out) {
+	if (strcmp_P(args, PSTR("defaults")) == 0) {
+		config_defaults();
+		fputs_P(PSTR("defaults restored, not saved\r\n"), out);
+		return;
+	}
+	config_save();
+	fputs_P(PSTR("saved\r\n"), out);
+}
+
+static void cmd_seq(char* args, FILE* out) {
+	if (strcmp_P(args, PSTR("clear")) == 0) {
+		seq_clear();
+		return;
+	}
+	if (strcmp_P(args, PSTR("reset")) == 0) {
+		seq_stats_reset();
+		return;
+	}
+	seq_stats_t st;
+	seq_stats(&st);
+	unsigned long avg = st.clocks ? st.totalLate / st.clocks : 0;
+	fprintf_P(out, PSTR("%lu clocks, late %lu us avg %u us max, interval %lu us +-%u us, %u MIDI bytes dropped\r\n"),
+		st.clocks, avg / TIMER_TICKS_PER_US, (unsigned)(st.maxLate / TIMER_TICKS_PER_US),
+		st.interval / TIMER_TICKS_PER_US, (unsigned)(st.jitter / TIMER_TICKS_PER_US), st.overruns);
+}
+
+static void cmd_set(char* args, FILE* out) {
+	char* value = strchr(args, ' ');
+	if (!value) {
+		fputs_P(PSTR("usage: set <name> <value>\r\n"), out);
+		return;
+	}
+	*value++ = '\0';
+	uint8_t index = config_find(args);
+	if (index == config_count()) {
+		fprintf_P(out, PSTR("unknown parameter: %s\r\n"), args);
+		return;
+	}
+	char* end;
+	long v = strtol(value, &end, 0);
+	if (end == value || v < INT16_MIN || v > INT16_MAX || !config_set(index, v)) {
+		int16_t min, max;
+		config_range(index, &min, &max);
+		fprintf_P(out, PSTR("%S must be %d to %d\r\n"), config_name(index), min, max);
+		return;
+	}
+	print_param(index, out);
+}
+
+#if defined(USE_SYNTH)
+static void cmd_synth(char* args, FILE* out) {
+	if (strcmp_P(args, PSTR("reset")) == 0) {
+		synth_stats_reset();
+		return;
+	}
+	if (*args >= '0' && *args <= '9') {
+		if (!synth_preset(atoi(args))) {
+			fprintf_P(out, PSTR("%u patches\r\n"), synth_preset_count());
+		}
+		return;
+	}
+	synth_stats_t st;
+	synth_stats(&st);
+	unsigned long avg = st.samples ? st.totalCycles / st.samples : 0;
+	fprintf_P(out, PSTR("%lu samples, %lu cycles avg, %u max, of %lu per sample\r\n"),
+		st.samples, avg, st.maxCycles, F_CPU / SYNTH_RATE);
+}
+#endif
+
+static void cmd_tempo(char* args, FILE* out) {
+	if (strcmp_P(args, PSTR("reset")) == 0) {
+		tempo_reset();
+		return;
+	}
+	tempo_t t;
+	tempo_status(&t);
+	if (!t.bpm) {
+		fputs_P(PSTR("no tempo\r\n"), out);
+		return;
+	}
+	fprintf_P(out, PSTR("%u.%02u bpm (%u ms), confidence %u, %u onsets\r\n"),
+		t.bpm >> 4, (t.bpm & 15) * 100 / 16, t.periodMs, t.confidence, t.onsets);
+}
+
+static void cmd_trace(char* args, FILE* out) {
+	(void)args;
+	uint8_t n = trace_count();
+	if (!n) {
+		return;
+	}
+	trace_entry_t last;
+	trace_get(n - 1, &last);
+	for (uint8_t i = 0; i < n; i++) {
+		trace_entry_t e;
+		trace_get(i, &e);
+		fprintf_P(out, PSTR("%6d %S %02x\r\n"), (int16_t)(e.ms - last.ms), trace_name(e.type), e.data);
+	}
+}
+
+static const command_t commands[] PROGMEM = {
+	{ "bench", cmd_bench },
+	{ "counters", cmd_counters },
+	{ "features", cmd_features },
+	{ "ga", cmd_ga },
+	{ "get", cmd_get },
+	{ "help", cmd_help },
+	{ "latency", cmd_latency },
+	{ "map", cmd_map },
+	{ "mem", cmd_mem },
+	{ "preset", cmd_preset },
+	{ "random", cmd_random },
+	{ "ring", cmd_ring },
+	{ "save", cmd_save },
+	{ "seq", cmd_seq },
+	{ "set", cmd_set },
+	{ "sleep", cmd_sleep },
+	{ "sof", cmd_sof },
+#if defined(USE_SYNTH)
+	{ "synth", cmd_synth },
+#endif
+	{ "tempo", cmd_tempo },
+	{ "trace", cmd_trace },
+};
+
+#define COMMAND_COUNT (sizeof(commands) / sizeof(commands[0]))
+
+static void cmd_help(char* args, FILE* out) {
+	(void)args;
+	for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+		fputs_P(commands[i].name, out);
+		fputs_P(PSTR("\r\n"), out);
+	}
+}
+
+static void execute(char* cmd, FILE* out) {
+	char* args = strchr(cmd, ' ');
+	if (args) {
+		*args++ = '\0';
+		while (*args == ' ') {
+			args++;
+		}
+	} else {
+		args = cmd + strlen(cmd);
+	}
+	if (*cmd == '\0') {
+		return;
+	}
+
+	for (uint8_t i = 0; i < COMMAND_COUNT; i++) {
+		if (strcmp_P(cmd, commands[i].name) == 0) {
+			command_fn_t run = (command_fn_t)pgm_read_word(&commands[i].run);
+			run(args, out);
+			return;
+		}
+	}
+	fprintf_P(out, PSTR("unknown command: %s\r\n"), cmd);
+}
+
+uint8_t command_receive(USB_ClassInfo_CDC_Device_t* cdc) {
+	port = cdc;
+	// Read straight into the ring, in at most two contiguous spans
+	for (uint8_t span = 0; span < 2; span++) {
+		uint8_t* at;
+		uint8_t space = rx_ring_write_span(&rx, &at);
+		if (space == 0) {
+			break;
+		}
+		uint8_t n = (uint8_t)CDC_Device_ReceiveData(cdc, at, space);
+		rx_ring_commit(&rx, n);
+		if (n < space) {
+			break;
+		}
+	}
+	uint8_t waiting = rx_ring_count(&rx);
+	COUNTERS_HIGH(commandHigh, waiting);
+	return waiting;
+}
+
+void command_process(FILE* out) {
+	uint8_t b;
+	while (rx_ring_pop(&rx, &b)) {
+		char c = b;
+		if (c == '\r' || c == '\n') {
+			if (!lineOverflow) {
+				line[lineLen] = '\0';
+				execute(line, out);
+			}
+			lineLen = 0;
+			lineOverflow = 0;
+		} else if (lineLen < COMMAND_LINE_MAX - 1) {
+			line[lineLen++] = c;
+		} else {
+			lineOverflow = 1;
+		}
+	}
+}
@@ -0,0 +1,231 @@
+/*
+ * Runtime configuration
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <avr/eeprom.h>
+#include <avr/io.h>
+#include <util/crc16.h>
+
+#include "config.h"
+#include "ga.h"
+#include "midi.h"
+#include "sched.h"
+#include "seq.h"
+
+static const config_t defaults PROGMEM = {
+	.debounceMs = CONFIG_DEBOUNCE_MS,
+	.i2cKhz = CONFIG_I2C_KHZ,
+	.hidMs = CONFIG_HID_MS,
+	.vendorMs = CONFIG_VENDOR_MS,
+	.noteBase = CONFIG_NOTE_BASE,
+	.velocity = CONFIG_VELOCITY,
+	.scale = CONFIG_SCALE,
+	.transpose = 0,
+	.channel = 0,
+	.chordMs = CONFIG_CHORD_MS,
+	.holdMs = CONFIG_HOLD_MS,
+	.tapMs = CONFIG_TAP_MS,
+	.evolve = 0,
+	.arp = 0,
+	.bpm = CONFIG_BPM,
+	.clock = 0,
+	.follow = 0,
+	.inputs = { [0 ... MIDI_INPUTS - 1] = { MIDI_DEFAULT, MIDI_DEFAULT, MIDI_DEFAULT } },
+};
+
+config_t config;
+
+typedef struct {
+	uint8_t seq;
+	uint8_t version;
+	config_t config;
+	uint16_t crc;  // over everything before it
+} config_slot_t;
+
+static config_slot_t EEMEM slots[CONFIG_SLOTS];
+_Static_assert(sizeof(slots) <= E2END + 1, "the save ring does not fit the EEPROM");
+// Index of the newest slot, found by config_load
+static uint8_t newest = CONFIG_SLOTS - 1;
+
+// i2c_delay_T2 costs 12 cycles plus 3 per loop, and must loop at least once
+#define I2C_HALF_PERIOD(khz) (((F_CPU / 2000UL / (khz)) - 12) / 3)
+
+uint8_t i2c_half_period = I2C_HALF_PERIOD(CONFIG_I2C_KHZ);
+
+enum {
+	PARAM_U8,
+	PARAM_U16,
+	PARAM_I8,
+};
+
+typedef struct {
+	char name[10];
+	uint8_t type;
+	uint8_t offset;
+	int16_t min;
+	int16_t max;
+	void (*apply)(void);
+} param_t;
+
+static void apply_i2c(void) {
+	uint16_t loops = I2C_HALF_PERIOD(config.i2cKhz);
+	i2c_half_period = loops ? (loops > 255 ? 255 : loops) : 1;
+}
+
+static void apply_rates(void) {
+#if defined(USE_HID_INTERFACE)
+	sched_every(TASK_HID, config.hidMs);
+#endif
+#if defined(USE_VENDOR_INTERFACE)
+	sched_every(TASK_VENDOR, config.vendorMs);
+#endif
+}
+
+static void apply_evolve(void) {
+	sched_every(TASK_GA, config.evolve ? GA_TICK_MS : 0);
+	if (!config.evolve) {
+		// back to the player's own mapping
+		midi_release();
+	}
+}
+
+static const param_t params[] PROGMEM = {
+	{ "arp", PARAM_U8, offsetof(config_t, arp), 0, SEQ_MODES - 1, seq_apply },
+	{ "bpm", PARAM_U8, offsetof(config_t, bpm), 30, 250, seq_apply },
+	{ "channel", PARAM_U8, offsetof(config_t, channel), 0, 15, midi_remap },
+	{ "chord", PARAM_U16, offsetof(config_t, chordMs), 0, 1000, NULL },
+	{ "clock", PARAM_U8, offsetof(config_t, clock), 0, 1, seq_apply },
+	{ "debounce", PARAM_U16, offsetof(config_t, debounceMs), 0, 1000, NULL },
+	{ "evolve", PARAM_U8, offsetof(config_t, evolve), 0, 1, apply_evolve },
+	{ "follow", PARAM_U8, offsetof(config_t, follow), 0, 1, NULL },
+	{ "hid", PARAM_U8, offsetof(config_t, hidMs), 1, 255, apply_rates },
+	{ "hold", PARAM_U16, offsetof(config_t, holdMs), 50, 10000, NULL },
+	{ "i2c", PARAM_U16, offsetof(config_t, i2cKhz), 10, 400, apply_i2c },
+	{ "note", PARAM_U8, offsetof(config_t, noteBase), 0, 127, midi_remap },
+	{ "scale", PARAM_U8, offsetof(config_t, scale), 0, SCALE_COUNT - 1, midi_release },
+	{ "tap", PARAM_U16, offsetof(config_t, tapMs), 20, 2000, NULL },
+	{ "transpose", PARAM_I8, offsetof(config_t, transpose), -48, 48, midi_release },
+	{ "vendor", PARAM_U8, offsetof(config_t, vendorMs), 1, 255, apply_rates },
+	{ "velocity", PARAM_U8, offsetof(config_t, velocity), 1, 127, midi_remap },
+};
+
+#define PARAM_COUNT (sizeof(params) / sizeof(params[0]))
+
+static uint16_t slot_crc(const config_slot_t* slot) {
+	uint16_t crc = 0xFFFF;
+	const uint8_t* p = (const uint8_t*)slot;
+	for (uint8_t i = 0; i < offsetof(config_slot_t, crc); i++) {
+		crc = _crc16_update(crc, p[i]);
+	}
+	return crc;
+}
+
+bool config_load(void) {
+	memcpy_P(&config, &defaults, sizeof(config));
+
+	// Sequence numbers count up around the ring, so the newest slot is the
+	// one its successor does not follow. Only the sequence bytes are read.
+	uint8_t seq = eeprom_read_byte(&slots[0].seq);
+	newest = CONFIG_SLOTS - 1;
+	for (uint8_t i = 0; i < CONFIG_SLOTS - 1; i++) {
+		uint8_t next = eeprom_read_byte(&slots[i + 1].seq);
+		if (next != (uint8_t)(seq + 1)) {
+			newest = i;
+			break;
+		}
+		seq = next;
+	}
+
+	// Normally the first block read is valid; step back past a torn write
+	uint8_t i = newest;
+	for (uint8_t tries = 0; tries < CONFIG_SLOTS; tries++) {
+		config_slot_t slot;
+		eeprom_read_block(&slot, &slots[i], sizeof(slot));
+		if (slot.version == CONFIG_VERSION && slot.crc == slot_crc(&slot)) {
+			config = slot.config;
+			return true;
+		}
+		i = i ? i - 1 : CONFIG_SLOTS - 1;
+	}
+	return false;
+}
+
+void config_save(void) {
+	uint8_t seq = eeprom_read_byte(&slots[newest].seq);
+	newest = (newest + 1) % CONFIG_SLOTS;
+
+	config_slot_t slot;
+	slot.seq = seq + 1;
+	slot.version = CONFIG_VERSION;
+	slot.config = config;
+	slot.crc = slot_crc(&slot);
+	eeprom_update_block(&slot, &slots[newest], sizeof(slot));
+}
+
+void config_defaults(void) {
+	memcpy_P(&config, &defaults, sizeof(config));
+	config_apply();
+}
+
+void config_apply(void) {
+	apply_i2c();
+	apply_rates();
+	apply_evolve();
+	midi_remap();
+	seq_apply();
+}
+
+uint8_t config_count(void) {
+	return PARAM_COUNT;
+}
+
+uint8_t config_find(const char* name) {
+	uint8_t i;
+	for (i = 0; i < PARAM_COUNT; i++) {
+		if (strcmp_P(name, params[i].name) == 0) {
+			break;
+		}
+	}
+	return i;
+}
+
+PGM_P config_name(uint8_t index) {
+	return params[index].name;
+}
+
+int16_t config_get(uint8_t index) {
+	uint8_t* field = (uint8_t*)&config + pgm_read_byte(&params[index].offset);
+	switch (pgm_read_byte(&params[index].type)) {
+		case PARAM_U16:
+			return *(uint16_t*)field;
+		case PARAM_I8:
+			return *(int8_t*)field;
+	}
+	return *field;
+}
+
+bool config_set(uint8_t index, int16_t value) {
+	int16_t min, max;
+	config_range(index, &min, &max);
+	if (value < min || value > max) {
+		return false;
+	}
+	uint8_t* field = (uint8_t*)&config + pgm_read_byte(&params[index].offset);
+	if (pgm_read_byte(&params[index].type) == PARAM_U16) {
+		*(uint16_t*)field = value;
+	} else {
+		*field = (uint8_t)value;
+	}
+	void (*apply)(void) = (void (*)(void))pgm_read_word(&params[index].apply);
+	if (apply) {
+		apply();
+	}
+	return true;
+}
+
+void config_range(uint8_t index, int16_t* min, int16_t* max) {
+	*min = pgm_read_word(&params[index].min);
+	*max = pgm_read_word(&params[index].max);
+}
@@ -0,0 +1,26 @@
+/*
+ * Usage counters
+ */
+
+#include <string.h>
+
+#include "counters.h"
+#include "timer.h"
+
+counters_t counters;
+
+static uint32_t resetMs = 0;
+
+void counters_snapshot(counters_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*out = counters;
+		out->ms = milliseconds - resetMs;
+	}
+}
+
+void counters_reset(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		memset(&counters, 0, sizeof(counters));
+		resetMs = milliseconds;
+	}
+}
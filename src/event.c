@@ -0,0 +1,45 @@
+/*
+ * Input event queue
+ */
+
+#include <util/crc16.h>
+
+#include "counters.h"
+#include "event.h"
+#include "ring.h"
+
+// One ring per reader, filled from the main loop and drained by the
+// reader's own context, the SPI ISR or the main loop, so neither side
+// masks interrupts and push_overwrite's handshake holds
+RING_DEFINE(event_ring, event_t, EVENT_QUEUE_SIZE);
+static event_ring_t queues[EVENT_READERS];
+
+void event_post(uint8_t type, uint8_t data, uint32_t time) {
+	event_t e = { .type = type, .data = data, .time = time };
+	for (uint8_t r = 0; r < EVENT_READERS; r++) {
+		// a reader that has fallen a full queue behind loses its oldest event
+		event_ring_push_overwrite(&queues[r], &e);
+		COUNTERS_HIGH(eventHigh[r], event_ring_count(&queues[r]));
+	}
+	COUNTERS_INC(events);
+}
+
+bool event_pop(uint8_t reader, event_t* out) {
+	return event_ring_pop(&queues[reader], out);
+}
+
+void event_frame(const event_t* e, uint8_t* frame) {
+	frame[0] = EVENT_FRAME_SYNC;
+	frame[1] = e->type;
+	frame[2] = e->data;
+	frame[3] = e->time;
+	frame[4] = e->time >> 8;
+	frame[5] = e->time >> 16;
+	frame[6] = e->time >> 24;
+
+	uint8_t crc = 0;
+	for (uint8_t i = 1; i < EVENT_FRAME_SIZE - 1; i++) {
+		crc = _crc8_ccitt_update(crc, frame[i]);
+	}
+	frame[EVENT_FRAME_SIZE - 1] = crc;
+}
@@ -0,0 +1,196 @@
+/*
+ * Interaction features
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include <util/atomic.h>
+
+#include "feature.h"
+#include "timer.h"
+
+// Exponential weight 1/8
+#define EW_SHIFT 3
+// Fractional bits of the running means
+#define MEAN_FRAC 4
+
+typedef struct {
+	int32_t mean;   // ms << MEAN_FRAC
+	uint32_t var;   // ms^2
+} ew_t;
+
+typedef struct {
+	uint32_t lastPress;  // Timer1
+	uint32_t pressTime;  // Timer1, of the press still held
+	ew_t ioi;
+	int32_t hold;        // ms << MEAN_FRAC
+	uint8_t bucket[FEATURE_WINDOW_S];
+	bool seen;
+} input_stats_t;
+
+static input_stats_t inputs[FEATURE_INPUTS];
+static ew_t ioi;
+static uint32_t lastPress;
+static bool anySeen;
+static uint8_t pairs[FEATURE_PAIRS];
+
+// Window bucket currently being counted into, and the second it started
+static uint8_t bucket;
+static unsigned long bucketStart;
+
+static feature_t summary;
+
+static void ew_add(ew_t* ew, uint16_t ms) {
+	int32_t diff = ((int32_t)ms << MEAN_FRAC) - ew->mean;
+	ew->mean += diff >> EW_SHIFT;
+	int32_t d = diff >> MEAN_FRAC;
+	uint32_t sq = (uint32_t)(d * d);
+	ew->var += ((int32_t)(sq - ew->var)) >> EW_SHIFT;
+}
+
+static uint16_t isqrt(uint32_t x) {
+	uint32_t root = 0;
+	uint32_t bit = 1UL << 30;
+	while (bit > x) {
+		bit >>= 2;
+	}
+	while (bit) {
+		if (x >= root + bit) {
+			x -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+static uint8_t units(uint32_t ms) {
+	ms /= FEATURE_UNIT_MS;
+	return ms > 255 ? 255 : ms;
+}
+
+static uint8_t pair_index(uint8_t i, uint8_t j) {
+	// row-major index of (i, j), i < j, in the upper triangle
+	return i * (2 * FEATURE_INPUTS - i - 1) / 2 + (j - i - 1);
+}
+
+// Milliseconds between two timestamps, or the cap if they are further apart
+static uint16_t interval(uint32_t from, uint32_t to) {
+	uint32_t ticks = to - from;
+	if (ticks >= (uint32_t)FEATURE_IOI_MAX_MS * TIMER_TICKS_PER_MS) {
+		return FEATURE_IOI_MAX_MS;
+	}
+	return ticks / TIMER_TICKS_PER_MS;
+}
+
+void feature_input(uint8_t state, uint8_t changed, uint32_t time) {
+	uint8_t pressed = state & changed;
+	for (uint8_t i = 0; i < FEATURE_INPUTS; i++) {
+		uint8_t bit = 1 << i;
+		input_stats_t* in = &inputs[i];
+		if (pressed & bit) {
+			if (in->seen) {
+				uint16_t ms = interval(in->lastPress, time);
+				if (ms < FEATURE_IOI_MAX_MS) {
+					ew_add(&in->ioi, ms);
+				}
+			}
+			if (anySeen) {
+				uint16_t ms = interval(lastPress, time);
+				if (ms < FEATURE_IOI_MAX_MS) {
+					ew_add(&ioi, ms);
+				}
+			}
+
+			// Pair with anything held, or pressed just before
+			for (uint8_t j = 0; j < FEATURE_INPUTS; j++) {
+				if (j == i) {
+					continue;
+				}
+				// inputs pressed in this same change were stamped with this time
+				// already if j < i, so each pair is only counted once
+				bool together = (state & ~changed & (1 << j))
+					|| (inputs[j].seen && interval(inputs[j].lastPress, time) < FEATURE_CHORD_MS);
+				if (together) {
+					uint8_t p = j < i ? pair_index(j, i) : pair_index(i, j);
+					if (pairs[p] < 255) {
+						pairs[p]++;
+					}
+				}
+			}
+
+			if (in->bucket[bucket] < 255) {
+				in->bucket[bucket]++;
+			}
+			in->lastPress = time;
+			in->pressTime = time;
+			in->seen = true;
+		} else if (changed & bit) {
+			uint16_t ms = interval(in->pressTime, time);
+			in->hold += (((int32_t)ms << MEAN_FRAC) - in->hold) >> EW_SHIFT;
+		}
+	}
+	if (pressed) {
+		lastPress = time;
+		anySeen = true;
+	}
+}
+
+void feature_task(void) {
+	// Step the window on a second at a time, clearing the buckets it enters
+	unsigned long now = millis();
+	while (now - bucketStart >= 1000) {
+		bucketStart += 1000;
+		bucket = (bucket + 1) % FEATURE_WINDOW_S;
+		for (uint8_t i = 0; i < FEATURE_INPUTS; i++) {
+			inputs[i].bucket[bucket] = 0;
+		}
+		if (bucket == 0) {
+			for (uint8_t p = 0; p < FEATURE_PAIRS; p++) {
+				pairs[p] >>= 1;
+			}
+		}
+	}
+
+	feature_t s;
+	s.presses = 0;
+	for (uint8_t i = 0; i < FEATURE_INPUTS; i++) {
+		input_stats_t* in = &inputs[i];
+		uint16_t presses = 0;
+		for (uint8_t b = 0; b < FEATURE_WINDOW_S; b++) {
+			presses += in->bucket[b];
+		}
+		s.presses += presses;
+		s.input[i].presses = presses > 255 ? 255 : presses;
+		s.input[i].ioiMean = units(in->ioi.mean >> MEAN_FRAC);
+		s.input[i].ioiSd = units(isqrt(in->ioi.var));
+		s.input[i].hold = units(in->hold >> MEAN_FRAC);
+	}
+	s.ioiMean = ioi.mean >> MEAN_FRAC;
+	s.ioiSd = isqrt(ioi.var);
+	for (uint8_t p = 0; p < FEATURE_PAIRS; p += 2) {
+		uint8_t lo = pairs[p] > 15 ? 15 : pairs[p];
+		uint8_t hi = pairs[p + 1] > 15 ? 15 : pairs[p + 1];
+		s.chords[p / 2] = lo | (hi << 4);
+	}
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		summary = s;
+	}
+}
+
+void feature_snapshot(feature_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*out = summary;
+	}
+}
+
+void feature_reset(void) {
+	memset(inputs, 0, sizeof(inputs));
+	memset(&ioi, 0, sizeof(ioi));
+	memset(pairs, 0, sizeof(pairs));
+	anySeen = false;
+	feature_task();
+}
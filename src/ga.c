@@ -0,0 +1,205 @@
+/*
+ * Genetic algorithm
+ */
+
+#include "ga.h"
+#include "prng.h"
+
+static genome_t population[2][GA_POPULATION];
+static uint16_t fitness[GA_POPULATION];
+static uint8_t active = 0;     // population[active] is the current generation
+static uint8_t children = 0;   // of the next generation bred so far
+static uint16_t generation = 0;
+static uint8_t best = 0;
+static genome_t lastBest = 0;
+static uint16_t lastBestFitness = 0;
+
+void ga_reset(void) {
+	for (uint8_t i = 0; i < GA_POPULATION; i++) {
+		population[active][i] = prng_next();
+		fitness[i] = 0;
+	}
+	children = 0;
+	generation = 0;
+	best = 0;
+}
+
+genome_t ga_individual(uint8_t index) {
+	return population[active][index];
+}
+
+void ga_set_fitness(uint8_t index, uint16_t value) {
+	fitness[index] = value;
+	if (value > fitness[best]) {
+		best = index;
+	}
+}
+
+static uint8_t tournament(uint32_t r) {
+	uint8_t a = r & (GA_POPULATION - 1);
+	uint8_t b = (r >> 8) & (GA_POPULATION - 1);
+	return fitness[a] >= fitness[b] ? a : b;
+}
+
+bool ga_breed(void) {
+	genome_t* next = population[active ^ 1];
+	if (children == 0) {
+		// elitism: the best genome carries over untouched
+		lastBest = population[active][best];
+		lastBestFitness = fitness[best];
+		next[children++] = lastBest;
+		return false;
+	}
+
+	uint32_t r = prng_next();
+	genome_t a = population[active][tournament(r)];
+	genome_t b = population[active][tournament(r >> 16)];
+	genome_t mask = prng_next();
+	genome_t child = (a & mask) | (b & ~mask);
+
+	// ANDing n random words sets each bit with probability 1 / 2^n
+	genome_t flips = prng_next();
+	for (uint8_t i = 1; i < GA_MUTATION_SHIFT; i++) {
+		flips &= prng_next();
+	}
+	next[children++] = child ^ flips;
+
+	if (children < GA_POPULATION) {
+		return false;
+	}
+	active ^= 1;
+	children = 0;
+	generation++;
+	best = 0;
+	for (uint8_t i = 0; i < GA_POPULATION; i++) {
+		fitness[i] = 0;
+	}
+	return true;
+}
+
+uint16_t ga_generation(void) {
+	return generation;
+}
+
+#if defined(__AVR__)
+
+#include <util/atomic.h>
+
+#include "config.h"
+#include "feature.h"
+#include "midi.h"
+#include "synth.h"
+#include "timer.h"
+
+static uint8_t current = 0;
+static bool breeding = false;
+static bool started = false;
+static unsigned long evalStart;
+// What ga_status reports. The SPI ISR reads it, so it is only replaced
+// whole, with interrupts off.
+static ga_status_t status;
+
+static void publish(void) {
+	ga_status_t s = {
+		.generation = generation,
+		.current = current,
+		.genome = population[active][current < GA_POPULATION ? current : 0],
+		.bestFitness = lastBestFitness,
+		.best = lastBest,
+	};
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		status = s;
+	}
+}
+
+void ga_express(genome_t g) {
+	midi_express(GENOME_SCALE(g), GENOME_TRANSPOSE(g));
+#if defined(USE_SYNTH)
+	synth_patch_t patch = {
+		.wave = GENOME_WAVE(g),
+		.attack = GENOME_ATTACK(g) * 16,
+		.decay = GENOME_DECAY(g) * 16,
+		.sustain = GENOME_SUSTAIN(g) * 17,
+		.release = GENOME_RELEASE(g) * 16,
+		.detune = GENOME_DETUNE(g),
+		.volume = 255,
+	};
+	synth_patch(&patch);
+#endif
+}
+
+// Engagement while a genome played: more presses, spread over more inputs,
+// more chords, and a steadier rhythm all score higher
+static uint16_t score(const feature_t* f) {
+	uint8_t distinct = 0;
+	for (uint8_t i = 0; i < FEATURE_INPUTS; i++) {
+		if (f->input[i].presses) {
+			distinct++;
+		}
+	}
+	uint8_t chords = 0;
+	for (uint8_t i = 0; i < sizeof(f->chords); i++) {
+		chords += (f->chords[i] & 0x0F) + (f->chords[i] >> 4);
+	}
+	// 64 for a perfectly even pulse, falling to 0 as the deviation reaches the mean
+	uint8_t steadiness = 0;
+	if (f->ioiMean) {
+		uint32_t cv = (uint32_t)f->ioiSd * 64 / f->ioiMean;
+		steadiness = cv >= 64 ? 0 : 64 - cv;
+	}
+	uint16_t presses = f->presses > 255 ? 255 : f->presses;
+	return presses * 2 + distinct * 16 + chords * 8 + steadiness * 2;
+}
+
+void ga_task(void) {
+	if (!config.evolve) {
+		started = false;
+		return;
+	}
+	if (!started) {
+		ga_reset();
+		current = 0;
+		breeding = false;
+		ga_express(ga_individual(0));
+		evalStart = millis();
+		started = true;
+		publish();
+		return;
+	}
+	if (breeding) {
+		if (ga_breed()) {
+			breeding = false;
+			current = 0;
+			ga_express(ga_individual(0));
+			evalStart = millis();
+		}
+		publish();
+		return;
+	}
+
+	if (millis() - evalStart < GA_EVAL_MS) {
+		return;
+	}
+	evalStart = millis();
+	feature_t f;
+	feature_snapshot(&f);
+	if (f.presses == 0) {
+		// nobody is playing: keep this genome until someone does
+		return;
+	}
+	ga_set_fitness(current, score(&f));
+	if (++current == GA_POPULATION) {
+		breeding = true;
+	} else {
+		ga_express(ga_individual(current));
+	}
+	publish();
+}
+
+void ga_status(ga_status_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*out = status;
+	}
+}
+
+#endif
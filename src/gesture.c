@@ -0,0 +1,137 @@
+/*
+ * Gesture recogniser
+ */
+
+#include <stdbool.h>
+
+#include "config.h"
+#include "event.h"
+#include "gesture.h"
+#include "sched.h"
+#include "timer.h"
+
+// Largest tap count that fits the event data
+#define TAP_MAX 31
+
+typedef enum {
+	IDLE,
+	PRESSED,   // down, may become a tap or a hold
+	RELEASED,  // up after a tap, waiting to see if another follows
+	HELD,      // hold reported, or part of a chord, until released
+} gesture_state_t;
+
+typedef struct {
+	uint8_t state;
+	uint8_t taps;
+	uint32_t start;  // press that started the gesture
+	uint32_t edge;   // latest press or release
+} input_gesture_t;
+
+static input_gesture_t inputs[GESTURE_INPUTS];
+
+// Presses gathered in the open chord window
+static uint8_t chordMask = 0;
+static uint32_t chordStart;
+
+static uint32_t ms_to_ticks(uint16_t ms) {
+	return (uint32_t)ms * TIMER_TICKS_PER_MS;
+}
+
+static void close_chord(void) {
+	// a single press is not a chord; it carries on as a tap or hold
+	if (chordMask & (chordMask - 1)) {
+		event_post(EVENT_CHORD, chordMask, chordStart);
+		for (uint8_t i = 0; i < GESTURE_INPUTS; i++) {
+			if (chordMask & (1 << i)) {
+				inputs[i].state = inputs[i].state == PRESSED ? HELD : IDLE;
+				inputs[i].taps = 0;
+			}
+		}
+	}
+	chordMask = 0;
+}
+
+static void post_taps(uint8_t i) {
+	event_post(EVENT_TAP, (inputs[i].taps << 3) | i, inputs[i].start);
+	inputs[i].taps = 0;
+}
+
+void gesture_input(uint8_t state, uint8_t changed, uint32_t time) {
+	if (chordMask && time - chordStart >= ms_to_ticks(config.chordMs)) {
+		close_chord();
+	}
+
+	for (uint8_t i = 0; i < GESTURE_INPUTS; i++) {
+		uint8_t bit = 1 << i;
+		if (!(changed & bit)) {
+			continue;
+		}
+		input_gesture_t* in = &inputs[i];
+		if (state & bit) {
+			if (!chordMask) {
+				chordStart = time;
+			}
+			chordMask |= bit;
+			if (in->state != RELEASED) {
+				in->taps = 0;
+				in->start = time;
+			}
+			in->state = PRESSED;
+		} else {
+			if (in->state == PRESSED) {
+				in->state = RELEASED;
+				if (++in->taps == TAP_MAX) {
+					post_taps(i);
+					in->state = IDLE;
+				}
+			} else {
+				in->state = IDLE;
+			}
+		}
+		in->edge = time;
+	}
+	sched_every(TASK_GESTURE, GESTURE_TICK_MS);
+}
+
+void gesture_task(void) {
+	uint32_t now = timer_ticks();
+	bool busy = false;
+
+	if (chordMask) {
+		if (now - chordStart >= ms_to_ticks(config.chordMs)) {
+			close_chord();
+		} else {
+			// taps and holds wait until it is known they are not a chord
+			return;
+		}
+	}
+
+	for (uint8_t i = 0; i < GESTURE_INPUTS; i++) {
+		input_gesture_t* in = &inputs[i];
+		switch (in->state) {
+			case PRESSED:
+				if (now - in->edge >= ms_to_ticks(config.holdMs)) {
+					if (in->taps) {
+						// the presses before this one were still taps
+						post_taps(i);
+					}
+					event_post(EVENT_HOLD, i, in->edge);
+					in->state = HELD;
+				} else {
+					busy = true;
+				}
+				break;
+			case RELEASED:
+				if (now - in->edge >= ms_to_ticks(config.tapMs)) {
+					post_taps(i);
+					in->state = IDLE;
+				} else {
+					busy = true;
+				}
+				break;
+		}
+	}
+	if (!busy) {
+		sched_every(TASK_GESTURE, 0);
+	}
+}
@@ -0,0 +1,80 @@
+/*
+ * USB HID gamepad
+ */
+
+#include "hid.h"
+#include "latency.h"
+#include "LUFA/Descriptors.h"
+
+#if defined(USE_HID_INTERFACE)
+
+static volatile uint8_t state = 0;
+static uint8_t reported = 0;
+static bool reportDue = false;
+static uint8_t idleRate = 0;
+
+bool hid_configure_endpoints(void) {
+	// The host learns the current state from the first report after configuration
+	reportDue = true;
+	return Endpoint_ConfigureEndpoint(HID_IN_EPADDR, EP_TYPE_INTERRUPT, HID_EPSIZE, 1);
+}
+
+void hid_process_control_request(void) {
+	if (!(Endpoint_IsSETUPReceived()) || USB_ControlRequest.wIndex != INTERFACE_ID_HID) {
+		return;
+	}
+
+	switch (USB_ControlRequest.bRequest) {
+		case HID_REQ_GetReport:
+			if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)) {
+				uint8_t report = state;
+				Endpoint_ClearSETUP();
+				Endpoint_Write_Control_Stream_LE(&report, sizeof(report));
+				Endpoint_ClearOUT();
+			}
+			break;
+		case HID_REQ_GetIdle:
+			if (USB_ControlRequest.bmRequestType == (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE)) {
+				Endpoint_ClearSETUP();
+				Endpoint_Write_8(idleRate);
+				Endpoint_ClearIN();
+				Endpoint_ClearStatusStage();
+			}
+			break;
+		case HID_REQ_SetIdle:
+			// Reports are only sent on change; the idle rate is stored but not acted on
+			if (USB_ControlRequest.bmRequestType == (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE)) {
+				Endpoint_ClearSETUP();
+				Endpoint_ClearStatusStage();
+				idleRate = USB_ControlRequest.wValue >> 8;
+			}
+			break;
+	}
+}
+
+void hid_set_state(uint8_t newState) {
+	state = newState;
+}
+
+void hid_task(void) {
+	uint8_t report = state;
+	if (USB_DeviceState != DEVICE_STATE_Configured || (report == reported && !reportDue)) {
+		return;
+	}
+
+	Endpoint_SelectEndpoint(HID_IN_EPADDR);
+	// If the host hasn't collected the last report yet, try again next tick
+	if (!(Endpoint_IsReadWriteAllowed())) {
+		return;
+	}
+	Endpoint_Write_8(report);
+	Endpoint_ClearIN();
+
+	if (report & ~reported) {
+		latency_sent();
+	}
+	reported = report;
+	reportDue = false;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ * Press-to-host latency histogram
+ */
+
+#include <string.h>
+#include <util/atomic.h>
+
+#include "latency.h"
+#include "timer.h"
+
+static latency_histogram_t histogram;
+static uint32_t captured;
+static uint8_t pending = 0;
+
+static uint8_t log2_bucket(uint32_t delta) {
+	uint8_t n = 0;
+	// skip whole bytes first, the common case is well under 2^16
+	while (delta > 0xFF) {
+		delta >>= 8;
+		n += 8;
+	}
+	while (delta > 1) {
+		delta >>= 1;
+		n++;
+	}
+	return n < LATENCY_BUCKETS ? n : LATENCY_BUCKETS - 1;
+}
+
+void latency_capture(uint32_t ticks) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (!pending) {
+			captured = ticks;
+			pending = 1;
+		}
+	}
+}
+
+void latency_sent(void) {
+	uint32_t now = timer_ticks();
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (pending) {
+			uint32_t delta = now - captured;
+			uint16_t* count = &histogram.bucket[log2_bucket(delta)];
+			if (*count != UINT16_MAX) {
+				(*count)++;
+			}
+			if (delta > histogram.max) {
+				histogram.max = delta;
+			}
+			pending = 0;
+		}
+	}
+}
+
+void latency_reset(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		memset(&histogram, 0, sizeof(histogram));
+		pending = 0;
+	}
+}
+
+void latency_snapshot(latency_histogram_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		memcpy(out, &histogram, sizeof(histogram));
+	}
+}
@@ -7,8 +7,10 @@
 
 #include <stdio.h>
 
+#include "counters.h"
 #include "mcp23017.h"
 #include "i2cmaster.h"
+#include "trace.h"
 
 uint8_t mcp23017_init(char** msg) {
 	uint8_t iocon = 0;
@@ -35,18 +37,30 @@ uint8_t mcp23017_init(char** msg) {
 }
 
 void mcp23017_write_reg(uint8_t reg, uint8_t data) {
-	i2c_start(MCP23017_ADDR + I2C_WRITE);
-	i2c_write(reg);
-	i2c_write(data);
+	trace(TRACE_I2C, reg);
+	uint8_t nak = i2c_start(MCP23017_ADDR + I2C_WRITE);
+	nak |= i2c_write(reg);
+	nak |= i2c_write(data);
 	i2c_stop();
+	if (nak) {
+		COUNTERS_INC(i2cErrors);
+		trace(TRACE_I2C_NAK, reg);
+	}
 }
 
 uint8_t mcp23017_read_reg(uint8_t reg) {
+	// i2c_start_wait spins until the device answers, so this is the last
+	// entry if it never does
+	trace(TRACE_I2C, reg);
 	i2c_start_wait(MCP23017_ADDR + I2C_WRITE);
-	i2c_write(reg);
-	i2c_rep_start(MCP23017_ADDR + I2C_READ);
+	uint8_t nak = i2c_write(reg);
+	nak |= i2c_rep_start(MCP23017_ADDR + I2C_READ);
 	uint8_t data = i2c_readNak();
 	i2c_stop();
+	if (nak) {
+		COUNTERS_INC(i2cErrors);
+		trace(TRACE_I2C_NAK, reg);
+	}
 
 	return data;
 }
\ No newline at end of file
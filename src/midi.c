@@ -5,14 +5,268 @@
  *  Author: Grant
  */
 
+#include <string.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "counters.h"
 #include "midi.h"
+#include "ring.h"
+
+#define NOTE_ON 0x90
+#define NOTE_OFF 0x80
+
+typedef struct {
+	uint8_t length;
+	uint8_t step[12];  // semitones above the root
+} scale_steps_t;
+
+static const scale_steps_t scales[SCALE_COUNT] PROGMEM = {
+	[SCALE_CHROMATIC] = { 12, { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 } },
+	[SCALE_MAJOR] = { 7, { 0, 2, 4, 5, 7, 9, 11 } },
+	[SCALE_MINOR] = { 7, { 0, 2, 3, 5, 7, 8, 10 } },
+	[SCALE_PENTATONIC] = { 5, { 0, 2, 4, 7, 9 } },
+	[SCALE_MINOR_PENTATONIC] = { 5, { 0, 3, 5, 7, 10 } },
+	[SCALE_BLUES] = { 6, { 0, 3, 5, 6, 7, 10 } },
+	[SCALE_DORIAN] = { 7, { 0, 2, 3, 5, 7, 9, 10 } },
+	[SCALE_WHOLE_TONE] = { 6, { 0, 2, 4, 6, 8, 10 } },
+};
+
+// Longest preset name plus its NUL
+#define PRESET_NAME_SIZE 13
+
+typedef struct {
+	char name[PRESET_NAME_SIZE];
+	uint8_t root;
+	uint8_t scale;
+	uint8_t channel;
+	const midi_input_t* inputs;  // PROGMEM overrides, or NULL for none
+} preset_t;
+
+#define D MIDI_DEFAULT
+
+// General MIDI kit with accents: kick, snare, closed and open hi-hat, low
+// and high tom, crash, ride
+static const midi_input_t drumKit[MIDI_INPUTS] PROGMEM = {
+	{ 36, D, 0x7F }, { 38, D, 0x70 }, { 42, D, 0x50 }, { 46, D, 0x60 },
+	{ 45, D, 0x68 }, { 50, D, 0x68 }, { 49, D, 0x7F }, { 51, D, 0x58 },
+};
+
+// Bass on channel 1 for the low four inputs, lead on channel 2 an octave
+// and a half up for the rest
+static const midi_input_t split[MIDI_INPUTS] PROGMEM = {
+	{ 36, 0, 0x60 }, { 40, 0, 0x60 }, { 43, 0, 0x60 }, { 47, 0, 0x60 },
+	{ 60, 1, D }, { 64, 1, D }, { 67, 1, D }, { 71, 1, D },
+};
+
+#undef D
+
+// name, root note, scale, channel, per-input overrides
+#define PRESETS(X) \
+	X("chromatic", 60, SCALE_CHROMATIC, 0, NULL) \
+	X("c-major", 60, SCALE_MAJOR, 0, NULL) \
+	X("a-minor", 57, SCALE_MINOR, 0, NULL) \
+	X("pentatonic", 60, SCALE_PENTATONIC, 0, NULL) \
+	X("a-minor-pent", 57, SCALE_MINOR_PENTATONIC, 0, NULL) \
+	X("blues", 60, SCALE_BLUES, 0, NULL) \
+	X("d-dorian", 62, SCALE_DORIAN, 0, NULL) \
+	X("whole-tone", 60, SCALE_WHOLE_TONE, 0, NULL) \
+	X("drums", 36, SCALE_CHROMATIC, 9, drumKit) \
+	X("split", 36, SCALE_MAJOR, 0, split)
+
+// A name exactly filling the array would be accepted without its NUL
+#define PRESET_NAME_CHECK(name, root, scale, channel, inputs) \
+	_Static_assert(sizeof(name) <= PRESET_NAME_SIZE, "preset name too long: " name);
+PRESETS(PRESET_NAME_CHECK)
+
+#define PRESET_ENTRY(name, root, scale, channel, inputs) { name, root, scale, channel, inputs },
+static const preset_t presets[] PROGMEM = {
+	PRESETS(PRESET_ENTRY)
+};
+
+#define PRESET_COUNT (sizeof(presets) / sizeof(presets[0]))
+
+// Scale and transposition expressed by the GA, used in place of config's
+// so that a save keeps the player's own
+static bool expressed = false;
+static uint8_t expressedScale;
+static int8_t expressedTranspose;
+
+// Built by midi_remap so a note costs one lookup per field
+static uint8_t notes[MIDI_INPUTS];
+static uint8_t channels[MIDI_INPUTS];
+static uint8_t velocities[MIDI_INPUTS];
+
+void Midi(uint8_t index, uint8_t on, midi_t* r) {
+	index %= MIDI_INPUTS;
+	r->status = (on ? NOTE_ON : NOTE_OFF) | channels[index];
+	r->note_number = notes[index];
+	r->velocity = on ? velocities[index] : 0x40;
+}
+
+static uint8_t clamp_note(int16_t note) {
+	return note < 0 ? 0 : (note > 127 ? 127 : note);
+}
+
+void midi_remap(void) {
+	// Presets can be switched from the SPI ISR, so the table is rebuilt
+	// with interrupts off. Walking the scale avoids any division.
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		uint8_t scale = expressed ? expressedScale : config.scale;
+		int8_t transpose = expressed ? expressedTranspose : config.transpose;
+		const scale_steps_t* s = &scales[scale < SCALE_COUNT ? scale : SCALE_CHROMATIC];
+		uint8_t length = pgm_read_byte(&s->length);
+		int16_t octave = config.noteBase + transpose;
+		uint8_t step = 0;
+		for (uint8_t i = 0; i < MIDI_INPUTS; i++) {
+			const midi_input_t* in = &config.inputs[i];
+			if (in->note != MIDI_DEFAULT) {
+				notes[i] = clamp_note(in->note + transpose);
+			} else {
+				notes[i] = clamp_note(octave + pgm_read_byte(&s->step[step]));
+			}
+			channels[i] = (in->channel != MIDI_DEFAULT ? in->channel : config.channel) & 0x0F;
+			velocities[i] = in->velocity != MIDI_DEFAULT ? in->velocity : config.velocity;
+			// overridden inputs still take their place in the scale
+			if (++step == length) {
+				step = 0;
+				octave += 12;
+			}
+		}
+	}
+}
+
+void midi_express(uint8_t scale, int8_t transpose) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		expressed = true;
+		expressedScale = scale;
+		expressedTranspose = transpose;
+		midi_remap();
+	}
+}
+
+void midi_release(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		expressed = false;
+		midi_remap();
+	}
+}
+
+bool midi_map(uint8_t input, const midi_input_t* map) {
+	if (input >= MIDI_INPUTS ||
+	    (map->note > 127 && map->note != MIDI_DEFAULT) ||
+	    (map->channel > 15 && map->channel != MIDI_DEFAULT) ||
+	    ((map->velocity == 0 || map->velocity > 127) && map->velocity != MIDI_DEFAULT)) {
+		return false;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		config.inputs[input] = *map;
+		midi_remap();
+	}
+	return true;
+}
+
+void midi_mapped(uint8_t input, midi_input_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		out->note = notes[input];
+		out->channel = channels[input];
+		out->velocity = velocities[input];
+	}
+}
+
+uint8_t midi_preset_count(void) {
+	return PRESET_COUNT;
+}
+
+PGM_P midi_preset_name(uint8_t preset) {
+	return presets[preset].name;
+}
+
+bool midi_preset(uint8_t preset) {
+	if (preset >= PRESET_COUNT) {
+		return false;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		config.noteBase = pgm_read_byte(&presets[preset].root);
+		config.scale = pgm_read_byte(&presets[preset].scale);
+		config.channel = pgm_read_byte(&presets[preset].channel);
+		const midi_input_t* inputs = (const midi_input_t*)pgm_read_word(&presets[preset].inputs);
+		if (inputs) {
+			memcpy_P(config.inputs, inputs, sizeof(config.inputs));
+		} else {
+			memset(config.inputs, MIDI_DEFAULT, sizeof(config.inputs));
+		}
+		config.transpose = 0;
+		midi_release();
+	}
+	return true;
+}
+
+void midi_set_notes(const uint8_t* table) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		for (uint8_t i = 0; i < MIDI_INPUTS; i++) {
+			notes[i] = table[i] & 0x7F;
+		}
+	}
+}
+
+void midi_transpose(int8_t semitones) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		config.transpose = semitones;
+		midi_release();
+	}
+}
+
+// Filled by midi_out, whose callers are serialised by masking interrupts,
+// and drained by the UDRE ISR
+RING_DEFINE(tx_ring, uint8_t, MIDI_TX_SIZE);
+static tx_ring_t tx;
+static uint16_t overruns = 0;
+
+void midi_out_init(void) {
+	UBRR1 = F_CPU / 16 / MIDI_BAUD - 1;
+	UCSR1C = (1 << UCSZ11) | (1 << UCSZ10);  // 8N1
+	UCSR1B = (1 << TXEN1);
+}
+
+bool midi_out(uint8_t b) {
+	bool queued = true;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (!tx_ring_count(&tx) && (UCSR1A & (1 << UDRE1))) {
+			UDR1 = b;
+		} else if (tx_ring_push(&tx, &b)) {
+			UCSR1B |= (1 << UDRIE1);
+			COUNTERS_HIGH(midiHigh, tx_ring_count(&tx));
+		} else {
+			overruns++;
+			queued = false;
+		}
+	}
+	return queued;
+}
+
+void midi_out_message(const midi_t* m) {
+	midi_out(m->status);
+	midi_out(m->note_number);
+	midi_out(m->velocity);
+}
+
+uint16_t midi_out_overruns(void) {
+	uint16_t n;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		n = overruns;
+	}
+	return n;
+}
 
-midi_t* Midi(uint8_t index, uint8_t on) {
-	midi_t* r = malloc(sizeof(midi_t));
-	// Note on/off, Channel 0
-	r->status = on ? 0x80: 0x90;
-	// We'll only consider the 12 notes of C3 (60-71)
-	r->note_number = index % 12 + 60;
-	// Full velocity
-	r->velocity = 0x7F;
-}
\ No newline at end of file
+ISR (USART1_UDRE_vect) {
+	uint8_t b;
+	if (tx_ring_pop(&tx, &b)) {
+		UDR1 = b;
+	}
+	if (!tx_ring_count(&tx)) {
+		UCSR1B &= ~(1 << UDRIE1);
+	}
+}
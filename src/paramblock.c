@@ -0,0 +1,143 @@
+/*
+ * Parameter block upload
+ */
+
+#include <util/atomic.h>
+#include <util/crc16.h>
+
+#include "ga.h"
+#include "midi.h"
+#include "paramblock.h"
+#include "sched.h"
+#include "synth.h"
+
+typedef enum {
+	IDLE,
+	TYPE,
+	LENGTH,
+	DATA,
+	CRC_LOW,
+	CRC_HIGH,
+} receive_state_t;
+
+static paramblock_t blocks[2];
+static paramblock_t* volatile live = &blocks[0];
+static paramblock_t* volatile shadow = &blocks[1];
+static volatile bool pending = false;
+
+// Receive state, only touched by the SPI ISR and the Timer1 ISR
+static uint8_t state = IDLE;
+static uint8_t length;
+static uint8_t received;
+static uint16_t crc;
+static uint16_t crcReceived;
+static uint8_t idleMs;
+// Skip a block that arrives before the last one was swapped in. Its bytes
+// are still counted, but never stored, since shadow holds the pending block.
+static bool discard;
+
+void paramblock_begin(void) {
+	state = TYPE;
+	crc = 0xFFFF;
+	idleMs = 0;
+	discard = pending;
+}
+
+bool paramblock_receiving(void) {
+	return state != IDLE;
+}
+
+uint8_t paramblock_receive(uint8_t byte) {
+	paramblock_t* b = shadow;
+	idleMs = 0;
+	if (state < CRC_LOW) {
+		crc = _crc_ccitt_update(crc, byte);
+	}
+	switch (state) {
+		case TYPE:
+			if (!discard) {
+				b->type = byte;
+			}
+			state = LENGTH;
+			break;
+		case LENGTH:
+			length = byte;
+			if (!discard) {
+				b->length = byte;
+			}
+			received = 0;
+			state = byte ? DATA : CRC_LOW;
+			break;
+		case DATA:
+			if (!discard && received < PARAMBLOCK_MAX) {
+				b->data[received] = byte;
+			}
+			if (++received == length) {
+				state = CRC_LOW;
+			}
+			break;
+		case CRC_LOW:
+			crcReceived = byte;
+			state = CRC_HIGH;
+			break;
+		case CRC_HIGH:
+			crcReceived |= (uint16_t)byte << 8;
+			state = IDLE;
+			if (discard) {
+				return PARAMBLOCK_PENDING;
+			}
+			if (length > PARAMBLOCK_MAX) {
+				return PARAMBLOCK_BAD_LENGTH;
+			}
+			if (crcReceived != crc) {
+				return PARAMBLOCK_BAD_CRC;
+			}
+			pending = true;
+			return PARAMBLOCK_OK;
+	}
+	return PARAMBLOCK_BUSY;
+}
+
+void paramblock_tick(void) {
+	if (pending) {
+		paramblock_t* b = live;
+		live = shadow;
+		shadow = b;
+		pending = false;
+		sched_post(TASK_PARAMBLOCK);
+	}
+	if (state != IDLE && ++idleMs > PARAMBLOCK_TIMEOUT_MS) {
+		state = IDLE;
+	}
+}
+
+void paramblock_task(void) {
+	// A newer block could be swapped in and the old buffer refilled while
+	// this one is applied, so work from a copy
+	paramblock_t copy;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		copy = *live;
+	}
+	const paramblock_t* b = &copy;
+	switch (b->type) {
+#if defined(USE_SYNTH)
+		case PARAMBLOCK_SYNTH_PATCH:
+			if (b->length == sizeof(synth_patch_t)) {
+				synth_patch((const synth_patch_t*)b->data);
+			}
+			break;
+#endif
+		case PARAMBLOCK_NOTES:
+			if (b->length == MIDI_INPUTS) {
+				midi_set_notes(b->data);
+			}
+			break;
+		case PARAMBLOCK_GENOME:
+			if (b->length == sizeof(genome_t)) {
+				genome_t g = b->data[0] | ((genome_t)b->data[1] << 8)
+					| ((genome_t)b->data[2] << 16) | ((genome_t)b->data[3] << 24);
+				ga_express(g);
+			}
+			break;
+	}
+}
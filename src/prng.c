@@ -0,0 +1,129 @@
+/*
+ * Pseudo-random numbers
+ */
+
+#include <string.h>
+
+#include "prng.h"
+
+#if defined(__AVR__)
+#include <avr/io.h>
+#include <avr/power.h>
+#include <util/atomic.h>
+#define PRNG_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#define PRNG_ATOMIC
+#endif
+
+#define DEFAULT_SEED 2463534242UL
+
+static uint32_t state = DEFAULT_SEED;
+static uint32_t pool = 0;
+static uint8_t poolSamples = 0;
+static prng_stats_t stats;
+// Filled by the main loop while blockReady is false, read by ISRs while it is true
+static uint8_t block[PRNG_BLOCK_BYTES];
+static volatile bool blockReady = false;
+
+static inline uint32_t xorshift(uint32_t x) {
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+void prng_seed(uint32_t seed) {
+	PRNG_ATOMIC {
+		state = seed ? seed : DEFAULT_SEED;
+	}
+}
+
+void prng_stir(uint8_t sample) {
+	PRNG_ATOMIC {
+		pool = ((pool << 5) | (pool >> 27)) ^ sample;
+		stats.samples++;
+		if (++poolSamples == PRNG_POOL_SAMPLES) {
+			poolSamples = 0;
+			state ^= pool;
+			if (!state) {
+				state = DEFAULT_SEED;
+			}
+			stats.reseeds++;
+		}
+	}
+}
+
+uint32_t prng_next(void) {
+	uint32_t x;
+	PRNG_ATOMIC {
+		x = state = xorshift(state);
+	}
+	return x;
+}
+
+void prng_fill(uint8_t* buf, uint8_t len) {
+	// Four bytes per step, with interrupts only held off for one step
+	while (len >= 4) {
+		uint32_t x = prng_next();
+		memcpy(buf, &x, 4);
+		buf += 4;
+		len -= 4;
+	}
+	if (len) {
+		uint32_t x = prng_next();
+		memcpy(buf, &x, len);
+	}
+}
+
+void prng_refill(void) {
+	if (blockReady) {
+		return;
+	}
+	prng_fill(block, PRNG_BLOCK_BYTES);
+	// The atomic block is also the barrier that keeps the fill before the hand-over
+	PRNG_ATOMIC {
+		blockReady = true;
+	}
+}
+
+bool prng_take(uint8_t* out) {
+	bool ready;
+	PRNG_ATOMIC {
+		ready = blockReady;
+		if (ready) {
+			memcpy(out, block, PRNG_BLOCK_BYTES);
+			blockReady = false;
+		} else {
+			memset(out, 0, PRNG_BLOCK_BYTES);
+		}
+	}
+	return ready;
+}
+
+void prng_stats(prng_stats_t* out) {
+	PRNG_ATOMIC {
+		*out = stats;
+	}
+}
+
+#if defined(__AVR__)
+
+void prng_init(void) {
+	power_adc_enable();
+	// Temperature sensor against the internal 2.56 V reference, ADC clock F_CPU/128
+	ADMUX = (1 << REFS1) | (1 << REFS0) | 0x07;
+	ADCSRB = (1 << MUX5);
+	ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+	for (uint8_t i = 0; i < PRNG_BOOT_SAMPLES; i++) {
+		ADCSRA |= (1 << ADSC);
+		while (ADCSRA & (1 << ADSC));
+		// ADCL first, which latches ADCH; only the low bits are noise
+		uint8_t low = ADCL;
+		(void)ADCH;
+		prng_stir(low);
+	}
+	ADCSRA = 0;
+	power_adc_disable();
+}
+
+#endif
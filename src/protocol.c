@@ -0,0 +1,113 @@
+/*
+ * Host command protocol
+ */
+
+#include <string.h>
+#include <util/atomic.h>
+
+#include "protocol.h"
+
+_Static_assert(sizeof(feature_t) <= PROTOCOL_MAX_RESPONSE, "feature_t does not fit the response buffer");
+_Static_assert(sizeof(seq_stats_t) <= PROTOCOL_MAX_RESPONSE, "seq_stats_t does not fit the response buffer");
+_Static_assert(sizeof(counters_t) <= PROTOCOL_MAX_RESPONSE, "counters_t does not fit the response buffer");
+_Static_assert(PROTOCOL_RANDOM_BYTES <= PROTOCOL_MAX_RESPONSE, "random block does not fit the response buffer");
+
+uint8_t protocol_command(uint8_t command, uint8_t reader, uint8_t* response) {
+	if ((command & 0xF0) == CMD_PRESET) {
+		midi_preset(command & 0x0F);
+		return 0;
+	}
+	if ((command & 0xE0) == CMD_TRANSPOSE) {
+		// sign-extend the 5-bit argument
+		int8_t semitones = (int8_t)((command & CMD_ARG_MASK) << 3) >> 3;
+		midi_transpose(semitones);
+		return 0;
+	}
+#if defined(USE_SYNTH)
+	if ((command & 0xF0) == CMD_SYNTH_PATCH) {
+		synth_preset(command & 0x0F);
+		return 0;
+	}
+#endif
+	switch (command) {
+		case CMD_SYNC:
+			return protocol_sync(timer_ticks(), response);
+		case CMD_BUTTONS: {
+			uint8_t pressed;
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+				pressed = buttons;
+				buttons = 0;
+			}
+			response[0] = pressed;
+			return 1;
+		}
+		case CMD_LATENCY:
+			latency_snapshot((latency_histogram_t*)response);
+			return sizeof(latency_histogram_t);
+		case CMD_LATENCY_RESET:
+			latency_reset();
+			return 0;
+		case CMD_SLEEP_STATS:
+			sched_stats((sched_stats_t*)response);
+			sched_stats_reset();
+			return sizeof(sched_stats_t);
+		case CMD_FEATURES:
+			feature_snapshot((feature_t*)response);
+			return sizeof(feature_t);
+		case CMD_PARAMBLOCK:
+			if (reader == EVENT_READER_SPI) {
+				paramblock_begin();
+			}
+			return 0;
+		case CMD_GA:
+			ga_status((ga_status_t*)response);
+			return sizeof(ga_status_t);
+		case CMD_RANDOM:
+			// Generating the block here would hold interrupts off too long
+			prng_take(response);
+			sched_post(TASK_RANDOM);
+			return PROTOCOL_RANDOM_BYTES;
+		case CMD_SEQ:
+			seq_stats((seq_stats_t*)response);
+			return sizeof(seq_stats_t);
+		case CMD_CLOCK:
+			seq_external_clock();
+			return 0;
+		case CMD_TEMPO:
+			tempo_status((tempo_t*)response);
+			return sizeof(tempo_t);
+		case CMD_COUNTERS:
+			counters_snapshot((counters_t*)response);
+			return sizeof(counters_t);
+		case CMD_COUNTERS_RESET:
+			counters_reset();
+			return 0;
+		case CMD_SOF:
+			sof_snapshot((sof_latch_t*)response);
+			return sizeof(sof_latch_t);
+		case CMD_EVENT: {
+			event_t e;
+			if (!event_pop(reader, &e)) {
+				memset(&e, 0, sizeof(e));
+			}
+			event_frame(&e, response);
+			return EVENT_FRAME_SIZE;
+		}
+	}
+	return 0;
+}
+
+uint8_t protocol_sync(uint32_t ticks, uint8_t* response) {
+	memcpy(response, &ticks, sizeof(ticks));
+	return sizeof(ticks);
+}
+
+bool protocol_carries_press(uint8_t command, const uint8_t* response) {
+	switch (command) {
+		case CMD_BUTTONS:
+			return response[0] != 0;
+		case CMD_EVENT:
+			return response[1] == EVENT_PRESS;
+	}
+	return false;
+}
@@ -0,0 +1,129 @@
+/*
+ * Cooperative run-to-completion scheduler
+ */
+
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+
+#include "sched.h"
+#include "timer.h"
+#include "trace.h"
+
+#define TASK_BIT(id) ((uint16_t)1 << (id))
+
+static sched_task_t tasks[TASK_COUNT];
+static volatile uint16_t pending = 0;
+static volatile uint8_t current = TASK_COUNT;
+
+// One countdown timer per task, reloaded from its period when it expires
+static uint16_t period[TASK_COUNT];
+static uint16_t countdown[TASK_COUNT];
+
+static uint32_t asleep = 0;
+static uint32_t wakeups = 0;
+static uint32_t statsSince = 0;
+
+void sched_register(uint8_t id, sched_task_t fn) {
+	tasks[id] = fn;
+}
+
+void sched_post(uint8_t id) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		pending |= TASK_BIT(id);
+	}
+}
+
+void sched_every(uint8_t id, uint16_t periodMs) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		period[id] = periodMs;
+		countdown[id] = periodMs;
+	}
+}
+
+void sched_tick(void) {
+	uint16_t expired = 0;
+	for (uint8_t id = 0; id < TASK_COUNT; id++) {
+		if (period[id] && --countdown[id] == 0) {
+			countdown[id] = period[id];
+			expired |= TASK_BIT(id);
+		}
+	}
+	pending |= expired;
+}
+
+uint8_t sched_current(void) {
+	return current;
+}
+
+void sched_stats(sched_stats_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		out->asleep = asleep;
+		out->elapsed = timer_ticks() - statsSince;
+		out->wakeups = wakeups;
+	}
+}
+
+void sched_stats_reset(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		asleep = 0;
+		wakeups = 0;
+		statsSince = timer_ticks();
+	}
+}
+
+/*!
+ * Sleep until the next interrupt, unless one has already posted work.
+ * The pending check and sleep are done with interrupts masked; sei takes
+ * effect after the following instruction, so no wakeup can be lost.
+ */
+static void idle(void) {
+	cli();
+	if (pending) {
+		sei();
+		return;
+	}
+	uint32_t start = timer_ticks();
+	sleep_enable();
+	sei();
+	sleep_cpu();
+	sleep_disable();
+	// the waking ISR has run by now, so this includes its time
+	uint32_t now = timer_ticks();
+	ATOMIC_BLOCK(ATOMIC_FORCEON) {
+		asleep += now - start;
+		wakeups++;
+	}
+}
+
+void sched_run(void) {
+	set_sleep_mode(SLEEP_MODE_IDLE);
+	for (;;) {
+		// Every pass through the loop shows it is still turning over
+		trace_watchdog_kick();
+		uint16_t ready;
+		ATOMIC_BLOCK(ATOMIC_FORCEON) {
+			ready = pending;
+		}
+		if (!ready) {
+			idle();
+			continue;
+		}
+
+		// Run only the highest priority task, then look again so anything
+		// posted meanwhile by an ISR gets its turn in priority order
+		for (uint8_t id = 0; id < TASK_COUNT; id++) {
+			if (ready & TASK_BIT(id)) {
+				ATOMIC_BLOCK(ATOMIC_FORCEON) {
+					pending &= ~TASK_BIT(id);
+				}
+				if (tasks[id]) {
+					current = id;
+					tasks[id]();
+					current = TASK_COUNT;
+				}
+				break;
+			}
+		}
+	}
+}
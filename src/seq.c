@@ -0,0 +1,320 @@
+/*
+ * Arpeggiator and step sequencer
+ */
+
+#include <string.h>
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "midi.h"
+#include "prng.h"
+#include "seq.h"
+#include "synth.h"
+#include "timer.h"
+
+#define NONE 0xFF
+
+typedef struct {
+	uint8_t input;
+	uint8_t note;  // as sent, in case the mapping changes before the note off
+} playing_t;
+
+static volatile uint8_t mode = SEQ_OFF;
+static bool external = false;
+static volatile uint8_t held = 0;
+static uint8_t pattern[SEQ_STEPS];
+static uint8_t step = 0;
+static uint8_t phase = 0;  // clocks into the step
+static uint8_t arpInput = NONE;
+static bool arpUp = true;
+static playing_t playing[MIDI_INPUTS];
+static uint8_t playingCount = 0;
+
+// Clock period in Timer1 ticks, with the remainder of the division by the
+// BPM spread Bresenham style, and the same period modulo a millisecond
+// for the compare match. error + remainder reaches 2 * bpm - 2, past a byte.
+static uint32_t period;
+static uint16_t remainder;
+static uint8_t bpm;
+static uint16_t error;
+static uint16_t periodCount;
+
+// The next clock, as a timestamp and as the TCNT1 value it falls on
+static uint32_t due;
+static uint16_t dueCount;
+
+static uint32_t lastClock;
+static seq_stats_t stats;
+
+static void note_on(uint8_t input) {
+	midi_t m;
+	Midi(input, 1, &m);
+	midi_out_message(&m);
+#if defined(USE_SYNTH)
+	synth_note(m.note_number, m.velocity, true);
+#endif
+	playing[playingCount].input = input;
+	playing[playingCount].note = m.note_number;
+	playingCount++;
+}
+
+static void notes_off(void) {
+	for (uint8_t i = 0; i < playingCount; i++) {
+		midi_t m;
+		Midi(playing[i].input, 0, &m);
+		m.note_number = playing[i].note;
+		midi_out_message(&m);
+#if defined(USE_SYNTH)
+		synth_note(m.note_number, 0, false);
+#endif
+	}
+	playingCount = 0;
+}
+
+static uint8_t next_above(uint8_t inputs, uint8_t i) {
+	// NONE wraps round to input 0
+	while (++i < MIDI_INPUTS) {
+		if (inputs & (1 << i)) {
+			return i;
+		}
+	}
+	return NONE;
+}
+
+static uint8_t next_below(uint8_t inputs, uint8_t i) {
+	if (i > MIDI_INPUTS) {
+		i = MIDI_INPUTS;
+	}
+	while (i-- > 0) {
+		if (inputs & (1 << i)) {
+			return i;
+		}
+	}
+	return NONE;
+}
+
+/*
+ * The input to play next from the held ones, which must not be none
+ */
+static uint8_t arp_next(uint8_t inputs) {
+	uint8_t i;
+	switch (mode) {
+		case SEQ_DOWN:
+			i = next_below(inputs, arpInput);
+			if (i == NONE) {
+				i = next_below(inputs, NONE);
+			}
+			break;
+		case SEQ_UPDOWN:
+			i = arpUp ? next_above(inputs, arpInput) : next_below(inputs, arpInput);
+			if (i == NONE) {
+				arpUp = !arpUp;
+				i = arpUp ? next_above(inputs, arpInput) : next_below(inputs, arpInput);
+			}
+			if (i == NONE) {
+				// only the last input played is held
+				i = next_above(inputs, NONE);
+			}
+			break;
+		case SEQ_RANDOM:
+			i = prng_next() & (MIDI_INPUTS - 1);
+			while (!(inputs & (1 << i))) {
+				i = (i + 1) & (MIDI_INPUTS - 1);
+			}
+			break;
+		default:
+			i = next_above(inputs, arpInput);
+			if (i == NONE) {
+				i = next_above(inputs, NONE);
+			}
+			break;
+	}
+	arpInput = i;
+	return i;
+}
+
+static void play_step(void) {
+	if (mode == SEQ_PATTERN) {
+		uint8_t mask = pattern[step];
+		for (uint8_t i = 0; i < MIDI_INPUTS; i++) {
+			if (mask & (1 << i)) {
+				note_on(i);
+			}
+		}
+	} else if (held) {
+		note_on(arp_next(held));
+	}
+}
+
+/*
+ * One 24 PPQN clock, from the compare match or the Pi. Runs with
+ * interrupts off.
+ */
+static void clock(uint32_t now) {
+	if (stats.clocks) {
+		int32_t d = (int32_t)(now - lastClock - stats.interval);
+		stats.interval += d / 8;
+		uint32_t dev = d < 0 ? -d : d;
+		if (dev > UINT16_MAX) {
+			dev = UINT16_MAX;
+		}
+		stats.jitter += ((int32_t)dev - stats.jitter) / 8;
+	}
+	lastClock = now;
+	stats.clocks++;
+
+	// Like Start and Stop, only the board's own clock goes out as MIDI clock
+	if (!external) {
+		midi_out(MIDI_CLOCK);
+	}
+	if (phase == 0) {
+		play_step();
+	} else if (phase == SEQ_GATE_CLOCKS) {
+		notes_off();
+	}
+	if (++phase == SEQ_CLOCKS_PER_STEP) {
+		phase = 0;
+		step = (step + 1) & (SEQ_STEPS - 1);
+	}
+}
+
+static void start(void) {
+	step = 0;
+	phase = 0;
+	arpInput = NONE;
+	arpUp = true;
+	stats.interval = period;
+	if (!external) {
+		midi_out(MIDI_START);
+		// First clock on the next millisecond boundary
+		error = 0;
+		dueCount = 0;
+		due = (milliseconds + 1) * TIMER_TICKS_PER_MS;
+		OCR1B = dueCount;
+		TIFR1 = (1 << OCF1B);
+		TIMSK1 |= (1 << OCIE1B);
+	}
+}
+
+static void stop(void) {
+	TIMSK1 &= ~(1 << OCIE1B);
+	notes_off();
+	if (!external) {
+		midi_out(MIDI_STOP);
+	}
+}
+
+void seq_apply(void) {
+	uint8_t newMode = config.arp < SEQ_MODES ? config.arp : SEQ_OFF;
+	bool newExternal = config.clock != 0;
+	// The divisions are done here so the clock interrupt only adds
+	uint32_t ticks = SEQ_TICKS_PER_CLOCK_BPM / config.bpm;
+	uint16_t rem = SEQ_TICKS_PER_CLOCK_BPM % config.bpm;
+	uint16_t count = ticks % TIMER_TICKS_PER_MS;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		period = ticks;
+		remainder = rem;
+		bpm = config.bpm;
+		periodCount = count;
+
+		bool wasRunning = mode != SEQ_OFF;
+		if (wasRunning && (newMode == SEQ_OFF || newExternal != external)) {
+			stop();
+			wasRunning = false;
+		}
+		if (newMode != mode) {
+			arpInput = NONE;
+		}
+		mode = newMode;
+		external = newExternal;
+		if (!wasRunning && mode != SEQ_OFF) {
+			start();
+		}
+	}
+}
+
+bool seq_running(void) {
+	return mode != SEQ_OFF;
+}
+
+void seq_input(uint8_t state, uint8_t changed) {
+	held = state;
+	uint8_t pressed = state & changed;
+	if (mode != SEQ_PATTERN || !pressed) {
+		return;
+	}
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		// Quantise to the nearest step. Phase 0 is the step about to play.
+		uint8_t s = phase <= SEQ_CLOCKS_PER_STEP / 2 ? step : step + 1;
+		pattern[s & (SEQ_STEPS - 1)] |= pressed;
+	}
+}
+
+void seq_external_clock(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (mode != SEQ_OFF && external) {
+			clock(timer_ticks());
+		}
+	}
+}
+
+void seq_clear(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		memset(pattern, 0, sizeof(pattern));
+	}
+}
+
+void seq_stats(seq_stats_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*out = stats;
+	}
+	out->overruns = midi_out_overruns();
+}
+
+void seq_stats_reset(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		uint32_t interval = stats.interval;
+		memset(&stats, 0, sizeof(stats));
+		stats.interval = interval;
+	}
+}
+
+/*
+ * Fires once a millisecond while the internal clock runs, at the TCNT1
+ * value of the next clock; only the match at or after the due time is a
+ * clock. That is decided from the timestamp rather than milliseconds,
+ * which COMPA may already have advanced when the match is at the top of
+ * the count.
+ */
+ISR (TIMER1_COMPB_vect) {
+	uint32_t now = timer_ticks();
+	if ((int32_t)(now - due) < 0) {
+		return;
+	}
+	uint32_t late = now - due;
+	if (late > UINT16_MAX) {
+		late = UINT16_MAX;
+	}
+	if (late > stats.maxLate) {
+		stats.maxLate = late;
+	}
+	stats.totalLate += late;
+
+	due += period;
+	dueCount += periodCount;
+	error += remainder;
+	if (error >= bpm) {
+		error -= bpm;
+		due++;
+		dueCount++;
+	}
+	if (dueCount >= TIMER_TICKS_PER_MS) {
+		dueCount -= TIMER_TICKS_PER_MS;
+	}
+	OCR1B = dueCount;
+
+	clock(now);
+}
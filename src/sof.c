@@ -0,0 +1,81 @@
+/*
+ * USB start-of-frame clock
+ */
+
+#include <util/atomic.h>
+
+#include "prng.h"
+#include "sof.h"
+#include "timer.h"
+#include "LUFA/USB.h"
+
+#define FRAME_MASK 0x7FF
+#define STALE_FRAMES 64
+
+static sof_latch_t latch;
+static uint32_t spanStart;
+static uint16_t spanFrames = 0;
+static bool latched = false;
+
+void sof_latch(void) {
+	uint32_t now = timer_ticks();
+	uint16_t frame = USB_Device_GetFrameNumber();
+
+	// Measure the local ticks over 1024 consecutive frames
+	if (latched && frame == ((latch.frame + 1) & FRAME_MASK)) {
+		if (++spanFrames == 1024) {
+			latch.ticksPer1024 = now - spanStart;
+			spanFrames = 0;
+			spanStart = now;
+		}
+	} else {
+		// first frame, or frames were missed: restart the span
+		spanFrames = 0;
+		spanStart = now;
+	}
+
+	latch.frame = frame;
+	latch.ticks = now;
+	// Host and local crystals beat against each other in the low bits
+	prng_stir((uint8_t)now);
+	latched = true;
+}
+
+void sof_snapshot(sof_latch_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*out = latch;
+	}
+}
+
+bool sof_frame_time(uint32_t ticks, uint16_t* frame, uint16_t* offset) {
+	sof_latch_t l;
+	bool valid;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		l = latch;
+		valid = latched;
+	}
+
+	int32_t delta = ticks - l.ticks;
+	int32_t frames = delta / (int32_t)TIMER_TICKS_PER_MS;
+	if (delta < 0 && frames * (int32_t)TIMER_TICKS_PER_MS != delta) {
+		frames--;  // round towards the earlier frame
+	}
+	if (!valid || frames > STALE_FRAMES || frames < -STALE_FRAMES) {
+		return false;
+	}
+	*frame = (l.frame + frames) & FRAME_MASK;
+	*offset = delta - frames * (int32_t)TIMER_TICKS_PER_MS;
+	return true;
+}
+
+int16_t sof_drift_ppm(void) {
+	uint32_t measured;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		measured = latch.ticksPer1024;
+	}
+	if (!measured) {
+		return 0;
+	}
+	const int32_t expected = 1024L * TIMER_TICKS_PER_MS;
+	return (int16_t)(((int64_t)((int32_t)measured - expected) * 1000000) / expected);
+}
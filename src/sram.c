@@ -0,0 +1,59 @@
+/*
+ * SRAM budget
+ */
+
+#include <avr/io.h>
+
+#include "sram.h"
+
+// Linker symbols bounding the sections, see the avr-libc linker scripts
+extern uint8_t __data_start;
+extern uint8_t __data_end;
+extern uint8_t __bss_start;
+extern uint8_t __bss_end;
+extern uint8_t __noinit_start;
+extern uint8_t __noinit_end;
+extern uint8_t __heap_start;
+extern uint8_t __stack;
+// Top of the heap, 0 until the first malloc
+extern char* __brkval;
+
+/*
+ * Paint from the end of .noinit to the top of RAM. Runs in .init1, before
+ * the stack pointer is set up, so it may not touch the stack.
+ */
+void sram_paint(void) __attribute__ ((naked, used, section (".init1")));
+void sram_paint(void) {
+	__asm__ volatile (
+		"	ldi r30, lo8(__heap_start)\n"
+		"	ldi r31, hi8(__heap_start)\n"
+		"	ldi r24, %0\n"
+		"	ldi r25, hi8(__stack)\n"
+		"	rjmp 2f\n"
+		"1:	st Z+, r24\n"
+		"2:	cpi r30, lo8(__stack)\n"
+		"	cpc r31, r25\n"
+		"	brlo 1b\n"
+		"	breq 1b\n"
+		:: "M" (SRAM_CANARY)
+	);
+}
+
+void sram_report(sram_t* out) {
+	out->data = &__data_end - &__data_start;
+	out->bss = &__bss_end - &__bss_start;
+	out->noinit = &__noinit_end - &__noinit_start;
+	uint8_t* heapEnd = __brkval ? (uint8_t*)__brkval : &__heap_start;
+	out->heap = heapEnd - &__heap_start;
+
+	// Lowest byte the stack has overwritten. A stray canary value on the
+	// stack can only make the peak look smaller by a few bytes.
+	uint8_t* p = heapEnd;
+	while (p <= &__stack && *p == SRAM_CANARY) {
+		p++;
+	}
+	out->unused = p - heapEnd;
+	out->stackPeak = &__stack + 1 - p;
+	out->stackNow = &__stack - (uint8_t*)SP;
+	out->total = RAMEND + 1 - RAMSTART;
+}
@@ -0,0 +1,263 @@
+/*
+ * Wavetable synthesiser
+ */
+
+#include <string.h>
+
+#include "synth.h"
+
+#if defined(USE_SYNTH)
+
+#if defined(__AVR__)
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <util/atomic.h>
+#define SYNTH_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#else
+#define SYNTH_ATOMIC
+#endif
+
+#define ENV_MAX 0xFFFF
+
+typedef enum {
+	STAGE_OFF,
+	STAGE_ATTACK,
+	STAGE_DECAY,
+	STAGE_SUSTAIN,
+	STAGE_RELEASE,
+} stage_t;
+
+typedef struct {
+	uint16_t phase;
+	uint16_t inc;
+	uint16_t level;  // envelope
+	uint8_t amp;     // level scaled by velocity, used per sample
+	uint8_t velocity;
+	uint8_t note;
+	uint8_t stage;
+} voice_t;
+
+// Phase increments for MIDI notes 108-119 at SYNTH_RATE; lower octaves shift down
+static const uint16_t topOctave[12] PROGMEM = {
+	17146, 18165, 19246, 20390, 21602, 22887, 24248, 25690, 27217, 28836, 30551, 32367,
+};
+
+static const synth_patch_t presets[] PROGMEM = {
+	// wave, attack, decay, sustain, release, detune, volume
+	{ SYNTH_WAVE_SAW, 1, 60, 0, 40, 0, 255 },        // pluck
+	{ SYNTH_WAVE_SINE, 100, 50, 200, 150, 0, 255 },  // pad
+	{ SYNTH_WAVE_ORGAN, 0, 0, 255, 10, 0, 200 },     // organ
+	{ SYNTH_WAVE_TRIANGLE, 0, 250, 0, 250, 2, 255 }, // bell
+};
+
+#define PRESET_COUNT (sizeof(presets) / sizeof(presets[0]))
+
+static voice_t voices[SYNTH_VOICES];
+static const int8_t* wave = synth_wavetables[SYNTH_WAVE_SINE];
+static uint8_t volume = 255;
+static int8_t detune = 0;
+static uint8_t sustain = 255;
+// envelope steps per control period
+static uint16_t attackStep = ENV_MAX;
+static uint16_t decayStep = ENV_MAX;
+static uint16_t releaseStep = ENV_MAX;
+
+static synth_stats_t stats;
+
+static uint16_t env_step(uint8_t time) {
+	return time ? ENV_MAX / ((uint16_t)time * 4) : ENV_MAX;
+}
+
+static uint16_t note_inc(uint8_t note) {
+	if (note >= 120) {
+		return pgm_read_word(&topOctave[note - 120]) << 1;
+	}
+	return pgm_read_word(&topOctave[note % 12]) >> (9 - note / 12);
+}
+
+void synth_patch(const synth_patch_t* patch) {
+	SYNTH_ATOMIC {
+		wave = synth_wavetables[patch->wave < SYNTH_WAVES ? patch->wave : SYNTH_WAVE_SINE];
+		attackStep = env_step(patch->attack);
+		decayStep = env_step(patch->decay);
+		releaseStep = env_step(patch->release);
+		sustain = patch->sustain;
+		detune = patch->detune;
+		volume = patch->volume;
+	}
+}
+
+uint8_t synth_preset_count(void) {
+	return PRESET_COUNT;
+}
+
+bool synth_preset(uint8_t preset) {
+	if (preset >= PRESET_COUNT) {
+		return false;
+	}
+	synth_patch_t patch;
+	memcpy_P(&patch, &presets[preset], sizeof(patch));
+	synth_patch(&patch);
+	return true;
+}
+
+static void synth_start(void) {
+#if defined(__AVR__)
+	TIMSK3 |= (1 << OCIE3A);
+#endif
+}
+
+void synth_note(uint8_t note, uint8_t velocity, bool on) {
+	SYNTH_ATOMIC {
+		if (!on) {
+			for (uint8_t i = 0; i < SYNTH_VOICES; i++) {
+				if (voices[i].note == note && voices[i].stage != STAGE_OFF) {
+					voices[i].stage = STAGE_RELEASE;
+				}
+			}
+		} else {
+			// Retrigger the same note, else take the quietest voice
+			voice_t* v = &voices[0];
+			for (uint8_t i = 0; i < SYNTH_VOICES; i++) {
+				if (voices[i].note == note && voices[i].stage != STAGE_OFF) {
+					v = &voices[i];
+					break;
+				}
+				if (v->stage != STAGE_OFF
+					&& (voices[i].stage == STAGE_OFF || voices[i].level < v->level)) {
+					v = &voices[i];
+				}
+			}
+			if (v->stage == STAGE_OFF) {
+				v->level = 0;
+				v->phase = 0;
+			}
+			v->note = note;
+			v->inc = note_inc(note) + detune;
+			v->velocity = velocity << 1;
+			v->stage = STAGE_ATTACK;
+			synth_start();
+		}
+	}
+}
+
+uint8_t synth_render(void) {
+	int16_t mix = 0;
+	for (uint8_t i = 0; i < SYNTH_VOICES; i++) {
+		voice_t* v = &voices[i];
+		v->phase += v->inc;
+		int8_t s = pgm_read_byte(&wave[v->phase >> 8]);
+		mix += (s * v->amp) >> 8;
+	}
+	// Half scale per pair of voices, clipping only when most of them peak together
+	mix >>= 1;
+	if (mix > 127) {
+		mix = 127;
+	} else if (mix < -127) {
+		mix = -127;
+	}
+	return (uint8_t)(((mix * volume) >> 8) + 128);
+}
+
+bool synth_control(void) {
+	bool active = false;
+	for (uint8_t i = 0; i < SYNTH_VOICES; i++) {
+		voice_t* v = &voices[i];
+		uint16_t level = v->level;
+		uint16_t target = (uint16_t)sustain << 8;
+		switch (v->stage) {
+			case STAGE_ATTACK:
+				if (level > ENV_MAX - attackStep) {
+					level = ENV_MAX;
+					v->stage = STAGE_DECAY;
+				} else {
+					level += attackStep;
+				}
+				break;
+			case STAGE_DECAY:
+				if (level < target + decayStep) {
+					level = target;
+					v->stage = STAGE_SUSTAIN;
+				} else {
+					level -= decayStep;
+				}
+				break;
+			case STAGE_SUSTAIN:
+				level = target;
+				break;
+			case STAGE_RELEASE:
+				if (level <= releaseStep) {
+					level = 0;
+					v->stage = STAGE_OFF;
+				} else {
+					level -= releaseStep;
+				}
+				break;
+		}
+		if (v->stage == STAGE_SUSTAIN && level == 0) {
+			v->stage = STAGE_OFF;
+		}
+		v->level = level;
+		v->amp = ((level >> 8) * v->velocity) >> 8;
+		active |= v->stage != STAGE_OFF;
+	}
+	return active;
+}
+
+void synth_stats(synth_stats_t* out) {
+	SYNTH_ATOMIC {
+		*out = stats;
+	}
+}
+
+void synth_stats_reset(void) {
+	SYNTH_ATOMIC {
+		memset(&stats, 0, sizeof(stats));
+	}
+}
+
+#if defined(__AVR__)
+
+void synth_init(void) {
+	// 96 MHz PLL from the 16 MHz crystal: USB takes it halved to 48 MHz,
+	// Timer4 takes it divided by 1.5 to 64 MHz, its maximum
+	PLLFRQ = (1 << PDIV3) | (1 << PDIV1) | (1 << PLLUSB) | (1 << PLLTM1);
+	PLLCSR = (1 << PINDIV) | (1 << PLLE);
+	while (!(PLLCSR & (1 << PLOCK)));
+
+	// Timer4: 8-bit fast PWM on OC4A (PC7), 250 kHz
+	DDRC |= (1 << PC7);
+	OCR4C = 255;
+	OCR4A = 128;
+	TCCR4A = (1 << COM4A1) | (1 << PWM4A);
+	TCCR4B = (1 << CS40);
+
+	// Timer3: sample clock. Its interrupt is only enabled while a voice sounds.
+	OCR3A = F_CPU / SYNTH_RATE - 1;
+	TCCR3A = 0;
+	TCCR3B = (1 << WGM32) | (1 << CS30);
+}
+
+ISR(TIMER3_COMPA_vect) {
+	static uint8_t control = 0;
+	OCR4A = synth_render();
+	if (++control == SYNTH_CONTROL_SAMPLES) {
+		control = 0;
+		if (!synth_control()) {
+			// silent: stop the sample interrupt until the next note
+			TIMSK3 &= ~(1 << OCIE3A);
+			OCR4A = 128;
+		}
+	}
+	// Timer3 runs at the CPU clock and restarted when this sample was due
+	uint16_t cycles = TCNT3;
+	if (cycles > stats.maxCycles) {
+		stats.maxCycles = cycles;
+	}
+	stats.totalCycles += cycles;
+	stats.samples++;
+}
+
+#endif
+
+#endif
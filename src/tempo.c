@@ -0,0 +1,153 @@
+/*
+ * Tap tempo
+ */
+
+#include <string.h>
+#include <util/atomic.h>
+
+#include "config.h"
+#include "seq.h"
+#include "tempo.h"
+#include "timer.h"
+
+// Periods are kept in 1/16 ms and variances in (1/16 ms)^2
+#define FRAC 4
+// Measurement noise, the scatter of a player's taps: about 20 ms
+#define NOISE_R ((uint32_t)(20 << FRAC) * (20 << FRAC))
+// Process noise, how far the player's tempo drifts per onset: about 4 ms
+#define NOISE_Q ((uint32_t)(4 << FRAC) * (4 << FRAC))
+
+static uint16_t period = 0;     // 0 while unlocked
+static uint32_t variance;
+static uint16_t candidate = 0;  // last interval while unlocked, 0 for none
+static uint8_t misses = 0;
+static uint32_t lastOnset;
+static bool seen = false;
+static tempo_t status;
+
+// Double or halve an interval into the tracked range of beat periods
+static uint16_t fold(uint16_t p) {
+	while (p < (TEMPO_MIN_MS << FRAC)) {
+		p <<= 1;
+	}
+	while (p > (TEMPO_MAX_MS << FRAC)) {
+		p >>= 1;
+	}
+	return p;
+}
+
+static void lock(uint16_t interval) {
+	uint16_t p = fold(interval);
+	uint16_t diff = p > candidate ? p - candidate : candidate - p;
+	if (candidate && diff <= candidate / 4) {
+		// two intervals agree
+		period = (p + candidate) / 2;
+		variance = NOISE_R;
+		misses = 0;
+		status.onsets = 2;
+		status.confidence = 64;
+		candidate = 0;
+	} else {
+		candidate = p;
+	}
+}
+
+static void track(uint16_t interval) {
+	// The interval as a beat count of 1/2, 1, 2, 3 or 4, whichever gives
+	// the period closest to the current one
+	int32_t residual = (int32_t)interval * 2 - period;
+	for (uint8_t beats = 1; beats <= 4; beats++) {
+		int32_t r = (int32_t)(interval / beats) - period;
+		if ((r < 0 ? -r : r) < (residual < 0 ? -residual : residual)) {
+			residual = r;
+		}
+	}
+
+	uint32_t magnitude = residual < 0 ? -residual : residual;
+	uint32_t r2 = magnitude * magnitude;
+	if (r2 > 9 * (variance + NOISE_R)) {
+		// over three standard deviations out
+		status.confidence -= status.confidence >> 2;
+		if (++misses >= TEMPO_RELOCK) {
+			period = 0;
+			status.confidence = 0;
+			candidate = fold(interval);
+		}
+		return;
+	}
+
+	misses = 0;
+	variance += NOISE_Q;
+	uint16_t gain = (variance << 8) / (variance + NOISE_R);  // 1/256
+	period += (gain * residual) >> 8;
+	variance -= (gain * variance) >> 8;
+	period = period < (TEMPO_MIN_MS << FRAC) ? (TEMPO_MIN_MS << FRAC)
+		: (period > (TEMPO_MAX_MS << FRAC) ? (TEMPO_MAX_MS << FRAC) : period);
+	status.confidence += (255 - status.confidence) >> 2;
+	if (status.onsets < 255) {
+		status.onsets++;
+	}
+}
+
+static void follow(void) {
+	if (!config.follow || status.confidence < TEMPO_FOLLOW_CONFIDENCE) {
+		return;
+	}
+	uint16_t bpm = (status.bpm + 8) >> 4;
+	bpm = bpm < 30 ? 30 : (bpm > 250 ? 250 : bpm);
+	// 2 BPM of hysteresis so tapping scatter does not keep retiming the clock
+	if (bpm >= config.bpm + 2 || bpm + 2 <= config.bpm) {
+		config.bpm = bpm;
+		seq_apply();
+	}
+}
+
+void tempo_input(uint8_t state, uint8_t changed, uint32_t time) {
+	if (!(state & changed)) {
+		return;
+	}
+	uint32_t ticks = time - lastOnset;
+	if (seen && ticks < (uint32_t)TEMPO_ONSET_MS * TIMER_TICKS_PER_MS) {
+		// part of the same chord or roll
+		return;
+	}
+	bool phrase = !seen || ticks >= (uint32_t)TEMPO_GAP_MS * TIMER_TICKS_PER_MS;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		lastOnset = time;
+		seen = true;
+		if (phrase) {
+			candidate = 0;
+		} else {
+			uint16_t interval = (ticks / TIMER_TICKS_PER_MS) << FRAC;
+			if (period) {
+				track(interval);
+			} else {
+				lock(interval);
+			}
+		}
+		status.periodMs = period >> FRAC;
+		// 60000 ms in 1/16 BPM over the period in 1/16 ms
+		status.bpm = period ? (60000UL << (2 * FRAC)) / period : 0;
+	}
+	follow();
+}
+
+void tempo_status(tempo_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*out = status;
+		if (seen && timer_ticks() - lastOnset >= (uint32_t)TEMPO_GAP_MS * TIMER_TICKS_PER_MS) {
+			// the player has stopped
+			out->confidence = 0;
+		}
+	}
+}
+
+void tempo_reset(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		period = 0;
+		candidate = 0;
+		misses = 0;
+		seen = false;
+		memset(&status, 0, sizeof(status));
+	}
+}
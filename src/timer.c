@@ -0,0 +1,49 @@
+/*
+ * Timer1 system tick
+ */
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+
+#include "paramblock.h"
+#include "sched.h"
+#include "timer.h"
+
+volatile unsigned long milliseconds = 0;
+
+void timer_init(void) {
+	// CTC mode, clk/8, compare match every TIMER_TICKS_PER_MS counts
+	TCCR1B |= (1 << WGM12) | (1 << CS11);
+	OCR1A = TIMER_TICKS_PER_MS - 1;
+	TIMSK1 |= (1 << OCIE1A);
+}
+
+unsigned long millis(void) {
+	unsigned long ms;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ms = milliseconds;
+	}
+	return ms;
+}
+
+uint32_t timer_ticks(void) {
+	uint32_t ms;
+	uint16_t count;
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		ms = milliseconds;
+		count = TCNT1;
+		// The compare match may have fired while interrupts were masked;
+		// if so the counter has already wrapped but milliseconds has not
+		if ((TIFR1 & (1 << OCF1A)) && count < TIMER_TICKS_PER_MS / 2) {
+			ms++;
+		}
+	}
+	return ms * TIMER_TICKS_PER_MS + count;
+}
+
+ISR (TIMER1_COMPA_vect) {
+	++milliseconds;
+	paramblock_tick();
+	sched_tick();
+}
@@ -0,0 +1,126 @@
+/*
+ * Flight recorder
+ */
+
+#include <avr/interrupt.h>
+#include <avr/io.h>
+#include <avr/wdt.h>
+#include <util/atomic.h>
+
+#include "sched.h"
+#include "timer.h"
+#include "trace.h"
+
+#define TRACE_MASK (TRACE_SIZE - 1)
+#define TRACE_MAGIC 0x7EC0
+
+// Left uninitialised by the C runtime, so they survive a reset
+static uint16_t magic __attribute__ ((section (".noinit")));
+static uint8_t head __attribute__ ((section (".noinit")));   // free-running
+static uint8_t count __attribute__ ((section (".noinit")));  // saturates at TRACE_SIZE
+static trace_entry_t ring[TRACE_SIZE] __attribute__ ((section (".noinit")));
+// Set by the watchdog interrupt, so the ISRs that keep running while the
+// main loop is stuck cannot push the entries before the hang out
+static volatile bool frozen __attribute__ ((section (".noinit")));
+
+static const char name_none[] PROGMEM = "-";
+static const char name_boot[] PROGMEM = "boot";
+static const char name_int2[] PROGMEM = "int2";
+static const char name_spi[] PROGMEM = "spi";
+static const char name_i2c[] PROGMEM = "i2c";
+static const char name_i2c_nak[] PROGMEM = "i2c-nak";
+static const char name_usb[] PROGMEM = "usb";
+static const char name_watchdog[] PROGMEM = "watchdog";
+
+static PGM_P const names[TRACE_TYPES] PROGMEM = {
+	[TRACE_NONE] = name_none,
+	[TRACE_BOOT] = name_boot,
+	[TRACE_INT2] = name_int2,
+	[TRACE_SPI] = name_spi,
+	[TRACE_I2C] = name_i2c,
+	[TRACE_I2C_NAK] = name_i2c_nak,
+	[TRACE_USB] = name_usb,
+	[TRACE_WATCHDOG] = name_watchdog,
+};
+
+bool trace_init(void) {
+	if (magic != TRACE_MAGIC || count > TRACE_SIZE) {
+		// power-on: RAM holds noise
+		magic = TRACE_MAGIC;
+		head = 0;
+		count = 0;
+		frozen = false;
+		return false;
+	}
+	// A bootloader may have cleared WDRF, but not the frozen flag
+	return count && (frozen || (MCUSR & (1 << WDRF)));
+}
+
+void trace_restart(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		head = 0;
+		count = 0;
+		frozen = false;
+	}
+	trace(TRACE_BOOT, 0);
+}
+
+void trace(uint8_t type, uint8_t data) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		if (frozen) {
+			return;
+		}
+		trace_entry_t* e = &ring[head++ & TRACE_MASK];
+		e->type = type;
+		e->data = data;
+		e->ms = milliseconds;
+		if (count < TRACE_SIZE) {
+			count++;
+		}
+	}
+}
+
+uint8_t trace_count(void) {
+	return count;
+}
+
+void trace_get(uint8_t index, trace_entry_t* out) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		*out = ring[(uint8_t)(head - count + index) & TRACE_MASK];
+	}
+}
+
+PGM_P trace_name(uint8_t type) {
+	return (PGM_P)pgm_read_word(&names[type < TRACE_TYPES ? type : TRACE_NONE]);
+}
+
+void trace_watchdog_enable(void) {
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+		wdt_reset();
+		// Timed sequence: the second write must follow within 4 cycles
+		WDTCSR = (1 << WDCE) | (1 << WDE);
+		WDTCSR = (1 << WDIE) | (1 << WDE) | (1 << WDP2) | (1 << WDP1) | (1 << WDP0);
+	}
+}
+
+void trace_watchdog_kick(void) {
+	wdt_reset();
+	if (frozen) {
+		// The loop came back after the interrupt. Go back to recording,
+		// and to interrupt mode, or the next stall resets unrecorded.
+		ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+			frozen = false;
+			WDTCSR |= (1 << WDIE);
+		}
+	}
+}
+
+/*
+ * The main loop has not kicked the watchdog for 2 s. Taking this interrupt
+ * clears WDIE, so the next timeout resets the board unless the loop kicks
+ * it first.
+ */
+ISR (WDT_vect) {
+	trace(TRACE_WATCHDOG, sched_current());
+	frozen = true;
+}
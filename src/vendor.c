@@ -0,0 +1,94 @@
+/*
+ * USB vendor-specific event stream
+ */
+
+#include "vendor.h"
+#include "protocol.h"
+#include "LUFA/Descriptors.h"
+
+#if defined(USE_VENDOR_INTERFACE)
+
+_Static_assert(PROTOCOL_MAX_RESPONSE <= VENDOR_EPSIZE, "a response must fit one IN bank");
+
+// Commands from the last OUT packet still to be answered
+static uint8_t commands[VENDOR_EPSIZE];
+static uint8_t commandCount = 0;
+static uint8_t commandNext = 0;
+
+bool vendor_configure_endpoints(void) {
+	commandCount = 0;
+	commandNext = 0;
+	return Endpoint_ConfigureEndpoint(VENDOR_IN_EPADDR, EP_TYPE_BULK, VENDOR_EPSIZE, 2) &&
+	       Endpoint_ConfigureEndpoint(VENDOR_OUT_EPADDR, EP_TYPE_BULK, VENDOR_EPSIZE, 1);
+}
+
+/*
+ * Whether the selected IN bank can take n more bytes without waiting on the
+ * host. A bank too full for them is sent on, giving the other bank a turn.
+ */
+static bool in_room(uint8_t n) {
+	if (Endpoint_IsReadWriteAllowed() && Endpoint_BytesFreeInEndpoint() >= n) {
+		return true;
+	}
+	if (Endpoint_IsINReady() && Endpoint_BytesInEndpoint()) {
+		Endpoint_ClearIN();
+	}
+	return Endpoint_IsReadWriteAllowed() && Endpoint_BytesFreeInEndpoint() >= n;
+}
+
+void vendor_task(void) {
+	if (USB_DeviceState != DEVICE_STATE_Configured) {
+		return;
+	}
+
+	// Commands from the host are answered in order, ahead of any further
+	// events. The next packet is only taken once this one is answered, so
+	// the host is held off by NAKs rather than the task waiting on it.
+	if (commandNext == commandCount) {
+		commandCount = 0;
+		commandNext = 0;
+		Endpoint_SelectEndpoint(VENDOR_OUT_EPADDR);
+		if (Endpoint_IsOUTReceived()) {
+			commandCount = Endpoint_BytesInEndpoint();
+			Endpoint_Read_Stream_LE(commands, commandCount, NULL);
+			Endpoint_ClearOUT();
+		}
+	}
+
+	// A command only runs once there is room for any response, so neither
+	// the command nor its response is lost; otherwise it waits for the next run
+	Endpoint_SelectEndpoint(VENDOR_IN_EPADDR);
+	uint8_t response[PROTOCOL_MAX_RESPONSE];
+	while (commandNext < commandCount) {
+		if (!in_room(PROTOCOL_MAX_RESPONSE)) {
+			return;
+		}
+		uint8_t command = commands[commandNext++];
+		uint8_t len = protocol_command(command, EVENT_READER_USB, response);
+		if (len) {
+			Endpoint_Write_Stream_LE(response, len, NULL);
+			if (protocol_carries_press(command, response)) {
+				latency_sent();
+			}
+		}
+	}
+
+	// Stream events while the bank has room for whole frames. If the host
+	// isn't reading, the banks stay full and events back up in the queue.
+	event_t e;
+	uint8_t frame[EVENT_FRAME_SIZE];
+	while (in_room(EVENT_FRAME_SIZE) && event_pop(EVENT_READER_USB, &e)) {
+		event_frame(&e, frame);
+		Endpoint_Write_Stream_LE(frame, EVENT_FRAME_SIZE, NULL);
+		if (e.type == EVENT_PRESS) {
+			latency_sent();
+		}
+	}
+
+	// Don't wait for a full bank, latency matters more than packing
+	if (Endpoint_IsINReady() && Endpoint_BytesInEndpoint()) {
+		Endpoint_ClearIN();
+	}
+}
+
+#endif
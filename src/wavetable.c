@@ -0,0 +1,88 @@
+/*
+ * Synth wavetables
+ *
+ * One cycle of each waveform, 256 signed 8-bit samples. The saw is built
+ * from its first eight harmonics and the organ from four, to keep aliasing
+ * down at the synth's sample rate.
+ */
+
+#include "synth.h"
+
+#if defined(USE_SYNTH)
+
+const int8_t synth_wavetables[SYNTH_WAVES][256] PROGMEM = {
+	[SYNTH_WAVE_SINE] = {
+		0, 3, 6, 9, 12, 16, 19, 22, 25, 28, 31, 34, 37, 40, 43, 46,
+		49, 51, 54, 57, 60, 63, 65, 68, 71, 73, 76, 78, 81, 83, 85, 88,
+		90, 92, 94, 96, 98, 100, 102, 104, 106, 107, 109, 111, 112, 113, 115, 116,
+		117, 118, 120, 121, 122, 122, 123, 124, 125, 125, 126, 126, 126, 127, 127, 127,
+		127, 127, 127, 127, 126, 126, 126, 125, 125, 124, 123, 122, 122, 121, 120, 118,
+		117, 116, 115, 113, 112, 111, 109, 107, 106, 104, 102, 100, 98, 96, 94, 92,
+		90, 88, 85, 83, 81, 78, 76, 73, 71, 68, 65, 63, 60, 57, 54, 51,
+		49, 46, 43, 40, 37, 34, 31, 28, 25, 22, 19, 16, 12, 9, 6, 3,
+		0, -3, -6, -9, -12, -16, -19, -22, -25, -28, -31, -34, -37, -40, -43, -46,
+		-49, -51, -54, -57, -60, -63, -65, -68, -71, -73, -76, -78, -81, -83, -85, -88,
+		-90, -92, -94, -96, -98, -100, -102, -104, -106, -107, -109, -111, -112, -113, -115, -116,
+		-117, -118, -120, -121, -122, -122, -123, -124, -125, -125, -126, -126, -126, -127, -127, -127,
+		-127, -127, -127, -127, -126, -126, -126, -125, -125, -124, -123, -122, -122, -121, -120, -118,
+		-117, -116, -115, -113, -112, -111, -109, -107, -106, -104, -102, -100, -98, -96, -94, -92,
+		-90, -88, -85, -83, -81, -78, -76, -73, -71, -68, -65, -63, -60, -57, -54, -51,
+		-49, -46, -43, -40, -37, -34, -31, -28, -25, -22, -19, -16, -12, -9, -6, -3,
+	},
+	[SYNTH_WAVE_TRIANGLE] = {
+		0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30,
+		32, 34, 36, 38, 40, 42, 44, 46, 48, 50, 52, 54, 56, 58, 60, 62,
+		64, 65, 67, 69, 71, 73, 75, 77, 79, 81, 83, 85, 87, 89, 91, 93,
+		95, 97, 99, 101, 103, 105, 107, 109, 111, 113, 115, 117, 119, 121, 123, 125,
+		127, 125, 123, 121, 119, 117, 115, 113, 111, 109, 107, 105, 103, 101, 99, 97,
+		95, 93, 91, 89, 87, 85, 83, 81, 79, 77, 75, 73, 71, 69, 67, 65,
+		64, 62, 60, 58, 56, 54, 52, 50, 48, 46, 44, 42, 40, 38, 36, 34,
+		32, 30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2,
+		0, -2, -4, -6, -8, -10, -12, -14, -16, -18, -20, -22, -24, -26, -28, -30,
+		-32, -34, -36, -38, -40, -42, -44, -46, -48, -50, -52, -54, -56, -58, -60, -62,
+		-64, -65, -67, -69, -71, -73, -75, -77, -79, -81, -83, -85, -87, -89, -91, -93,
+		-95, -97, -99, -101, -103, -105, -107, -109, -111, -113, -115, -117, -119, -121, -123, -125,
+		-127, -125, -123, -121, -119, -117, -115, -113, -111, -109, -107, -105, -103, -101, -99, -97,
+		-95, -93, -91, -89, -87, -85, -83, -81, -79, -77, -75, -73, -71, -69, -67, -65,
+		-64, -62, -60, -58, -56, -54, -52, -50, -48, -46, -44, -42, -40, -38, -36, -34,
+		-32, -30, -28, -26, -24, -22, -20, -18, -16, -14, -12, -10, -8, -6, -4, -2,
+	},
+	[SYNTH_WAVE_SAW] = {
+		0, 0, 0, 0, 0, 1, 1, 2, 3, 4, 5, 7, 9, 10, 12, 14,
+		16, 18, 19, 21, 23, 24, 25, 26, 27, 27, 28, 28, 28, 28, 28, 28,
+		28, 28, 28, 28, 29, 30, 30, 32, 33, 34, 36, 38, 40, 42, 44, 46,
+		48, 50, 51, 53, 54, 55, 56, 56, 56, 56, 56, 56, 56, 56, 55, 55,
+		55, 55, 55, 56, 57, 58, 59, 61, 63, 65, 67, 70, 72, 75, 77, 79,
+		81, 83, 85, 86, 86, 87, 87, 86, 85, 85, 83, 82, 81, 80, 79, 79,
+		78, 79, 79, 81, 82, 85, 88, 91, 95, 99, 104, 108, 112, 116, 120, 123,
+		125, 127, 127, 126, 124, 120, 115, 109, 101, 92, 82, 70, 57, 44, 29, 15,
+		0, -15, -29, -44, -57, -70, -82, -92, -101, -109, -115, -120, -124, -126, -127, -127,
+		-125, -123, -120, -116, -112, -108, -104, -99, -95, -91, -88, -85, -82, -81, -79, -79,
+		-78, -79, -79, -80, -81, -82, -83, -85, -85, -86, -87, -87, -86, -86, -85, -83,
+		-81, -79, -77, -75, -72, -70, -67, -65, -63, -61, -59, -58, -57, -56, -55, -55,
+		-55, -55, -55, -56, -56, -56, -56, -56, -56, -56, -56, -55, -54, -53, -51, -50,
+		-48, -46, -44, -42, -40, -38, -36, -34, -33, -32, -30, -30, -29, -28, -28, -28,
+		-28, -28, -28, -28, -28, -28, -28, -27, -27, -26, -25, -24, -23, -21, -19, -18,
+		-16, -14, -12, -10, -9, -7, -5, -4, -3, -2, -1, -1, 0, 0, 0, 0,
+	},
+	[SYNTH_WAVE_ORGAN] = {
+		0, 8, 16, 24, 32, 40, 48, 55, 62, 69, 76, 82, 88, 93, 99, 103,
+		108, 112, 115, 118, 121, 123, 124, 126, 127, 127, 127, 127, 126, 125, 124, 122,
+		120, 118, 116, 113, 110, 107, 105, 101, 98, 95, 92, 89, 86, 83, 80, 78,
+		75, 73, 70, 68, 66, 64, 63, 61, 60, 59, 58, 57, 57, 56, 56, 56,
+		56, 56, 56, 56, 56, 57, 57, 57, 58, 58, 58, 58, 58, 58, 58, 58,
+		58, 57, 57, 56, 55, 54, 53, 52, 51, 49, 48, 46, 44, 43, 41, 39,
+		37, 35, 33, 30, 28, 26, 24, 22, 20, 18, 16, 14, 13, 11, 10, 8,
+		7, 6, 5, 4, 3, 2, 2, 1, 1, 1, 0, 0, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0, 0, -1, -1, -1, -2, -2, -3, -4, -5, -6,
+		-7, -8, -10, -11, -13, -14, -16, -18, -20, -22, -24, -26, -28, -30, -33, -35,
+		-37, -39, -41, -43, -44, -46, -48, -49, -51, -52, -53, -54, -55, -56, -57, -57,
+		-58, -58, -58, -58, -58, -58, -58, -58, -58, -57, -57, -57, -56, -56, -56, -56,
+		-56, -56, -56, -56, -57, -57, -58, -59, -60, -61, -63, -64, -66, -68, -70, -73,
+		-75, -78, -80, -83, -86, -89, -92, -95, -98, -101, -105, -107, -110, -113, -116, -118,
+		-120, -122, -124, -125, -126, -127, -127, -127, -127, -126, -124, -123, -121, -118, -115, -112,
+		-108, -103, -99, -93, -88, -82, -76, -69, -62, -55, -48, -40, -32, -24, -16, -8,
+	},
+};
+
+#endif